@@ -153,7 +153,8 @@ static const char * const opcode_io_modes[] = {
 	"RAM access",
 	"BIOS access",
 	"Scratchpad access",
-	"Mapped I/O access"
+	"Mapped I/O access",
+	"FIFO access",
 };
 
 static const char * const opcode_branch_flags[] = {
@@ -226,6 +227,13 @@ static int print_flags(char *buf, size_t len, const struct opcode *op,
 			len -= bytes;
 			count += bytes;
 		}
+
+		if (op_flag_scratch_hint(flags)) {
+			bytes = do_snprintf(buf, len, &first, "", "scratchpad hint");
+			buf += bytes;
+			len -= bytes;
+			count += bytes;
+		}
 	}
 
 	if (OPT_EARLY_UNLOAD) {
@@ -28,6 +28,7 @@
 #define LIGHTREC_NO_INVALIDATE	BIT(3)
 #define LIGHTREC_NO_MASK	BIT(4)
 #define LIGHTREC_LOAD_DELAY	BIT(5)
+#define LIGHTREC_SCRATCH_HINT	BIT(18)
 
 /* I/O mode for load/store opcodes */
 #define LIGHTREC_IO_MODE_LSB	6
@@ -39,6 +40,7 @@
 #define LIGHTREC_IO_BIOS	0x4
 #define LIGHTREC_IO_SCRATCH	0x5
 #define LIGHTREC_IO_DIRECT_HW	0x6
+#define LIGHTREC_IO_FIFO	0x7
 #define LIGHTREC_IO_MASK	LIGHTREC_IO_MODE(0x7)
 #define LIGHTREC_FLAGS_GET_IO_MODE(x) \
 	(((x) & LIGHTREC_IO_MASK) >> LIGHTREC_IO_MODE_LSB)
@@ -52,6 +54,13 @@
 #define LIGHTREC_NO_HI		BIT(3)
 #define LIGHTREC_NO_DIV_CHECK	BIT(4)
 
+/* Interpreter handler resolved on first execution, see interpreter.c */
+#define LIGHTREC_INT_HANDLER_LSB	9
+#define LIGHTREC_INT_HANDLER(x)	((x) << LIGHTREC_INT_HANDLER_LSB)
+#define LIGHTREC_INT_HANDLER_MASK	LIGHTREC_INT_HANDLER(0x1ff)
+#define LIGHTREC_FLAGS_GET_INT_HANDLER(x) \
+	(((x) & LIGHTREC_INT_HANDLER_MASK) >> LIGHTREC_INT_HANDLER_LSB)
+
 #define LIGHTREC_REG_RS_LSB	26
 #define LIGHTREC_REG_RS(x)	((x) << LIGHTREC_REG_RS_LSB)
 #define LIGHTREC_REG_RS_MASK	LIGHTREC_REG_RS(0x3)
@@ -328,6 +337,11 @@ static inline _Bool op_flag_load_delay(u32 flags)
 	return OPT_HANDLE_LOAD_DELAYS && (flags & LIGHTREC_LOAD_DELAY);
 }
 
+static inline _Bool op_flag_scratch_hint(u32 flags)
+{
+	return flags & LIGHTREC_SCRATCH_HINT;
+}
+
 static inline _Bool op_flag_emulate_branch(u32 flags)
 {
 	return OPT_DETECT_IMPOSSIBLE_BRANCHES &&
@@ -1289,6 +1289,181 @@ static void rec_and_mask(struct lightrec_cstate *cstate,
 	}
 }
 
+static bool opcode_is_partial(union code c)
+{
+	return c.i.op == OP_LWL || c.i.op == OP_LWR
+		|| c.i.op == OP_SWL || c.i.op == OP_SWR;
+}
+
+static void rec_partial_shift(jit_state_t *_jit, union code c,
+			      u8 reg_out, u8 reg_in, u8 shift)
+{
+	/* LWL and SWR move the bytes towards the MSB, LWR and SWL towards the
+	 * LSB. The input register must be zero-extended for the latter. */
+	if (c.i.op == OP_LWL || c.i.op == OP_SWR)
+		jit_lshr(reg_out, reg_in, shift);
+	else
+		jit_rshr_u(reg_out, reg_in, shift);
+}
+
+static void rec_partial_get_shift(jit_state_t *_jit, union code c,
+				  u8 shift, u8 addr_reg)
+{
+	/* The shift amount in bits is derived from the two low bits of the
+	 * address; they are the same in the host address, as all the memory
+	 * maps are at least 32-bit aligned. */
+	jit_andi(shift, addr_reg, 3);
+
+	if (c.i.op == OP_LWL || c.i.op == OP_SWL)
+		jit_xori(shift, shift, 3);
+
+	jit_lshi(shift, shift, 3);
+}
+
+static u8 rec_alloc_partial_old(struct regcache *reg_cache,
+				jit_state_t *_jit, union code c)
+{
+	u8 rt, old;
+
+	/* LWL/LWR merge the loaded bytes with the previous value of rt, but
+	 * the output register is used to compute the address; save it. */
+	rt = lightrec_alloc_reg_in(reg_cache, _jit, c.i.rt, 0);
+	old = lightrec_alloc_reg_temp(reg_cache, _jit);
+
+	jit_movr(old, rt);
+	lightrec_free_reg(reg_cache, rt);
+
+	return old;
+}
+
+static void rec_load_partial(struct lightrec_cstate *cstate,
+			     jit_state_t *_jit, union code c,
+			     u8 rt, u8 addr_reg, s16 imm, u8 old)
+{
+	struct regcache *reg_cache = cstate->reg_cache;
+	u8 shift, mask;
+
+	shift = lightrec_alloc_reg_temp(reg_cache, _jit);
+	mask = lightrec_alloc_reg_temp(reg_cache, _jit);
+
+	if (imm) {
+		jit_addi(mask, addr_reg, imm);
+		addr_reg = mask;
+	}
+
+	rec_partial_get_shift(_jit, c, shift, addr_reg);
+
+	/* Load the aligned word */
+	jit_andi(rt, addr_reg, ~3);
+	jit_new_node_ww(__WORDSIZE == 64 ? jit_code_ldr_ui : jit_code_ldr_i,
+			rt, rt);
+
+	if (is_big_endian())
+		jit_bswapr_ui(rt, rt);
+
+	/* rt = (mem SHIFT s) | (old & ~(0xffffffff SHIFT s)) */
+	jit_movi(mask, 0xffffffff);
+	rec_partial_shift(_jit, c, mask, mask, shift);
+	rec_partial_shift(_jit, c, rt, rt, shift);
+
+	jit_comr(mask, mask);
+	jit_andr(mask, old, mask);
+	jit_orr(rt, rt, mask);
+
+	if (__WORDSIZE == 64)
+		jit_extr_i(rt, rt);
+
+	lightrec_free_reg(reg_cache, shift);
+	lightrec_free_reg(reg_cache, mask);
+}
+
+static void rec_store_partial_aligned(jit_state_t *_jit, union code c,
+				      u8 addr_reg, s16 imm, u8 src_reg,
+				      u8 tmp, u8 val, unsigned int align)
+{
+	/* SWL stores the (align + 1) upper bytes of rt, SWR the (4 - align)
+	 * lower bytes; the other bytes of the aligned word are kept. */
+	unsigned int shift = c.i.op == OP_SWL ? (3 - align) * 8 : align * 8;
+	s16 offset = imm - align;
+	u32 keep;
+
+	if (!shift) {
+		/* The whole word is written */
+		if (is_big_endian()) {
+			jit_bswapr_ui(val, src_reg);
+			src_reg = val;
+		}
+
+		jit_stxi_i(offset, addr_reg, src_reg);
+		return;
+	}
+
+	jit_ldxi_i(tmp, addr_reg, offset);
+
+	if (is_big_endian())
+		jit_bswapr_ui(tmp, tmp);
+
+	if (c.i.op == OP_SWL) {
+		keep = ~(0xffffffff >> shift);
+
+		if (__WORDSIZE == 64) {
+			jit_extr_ui(val, src_reg);
+			src_reg = val;
+		}
+
+		jit_rshi_u(val, src_reg, shift);
+	} else {
+		keep = ~(0xffffffff << shift);
+
+		jit_lshi(val, src_reg, shift);
+	}
+
+	jit_andi(tmp, tmp, keep);
+	jit_orr(val, val, tmp);
+
+	if (is_big_endian())
+		jit_bswapr_ui(val, val);
+
+	jit_stxi_i(offset, addr_reg, val);
+}
+
+static void rec_store_partial(struct lightrec_cstate *cstate,
+			      jit_state_t *_jit, union code c,
+			      u8 addr_reg, s16 imm, u8 src_reg)
+{
+	struct regcache *reg_cache = cstate->reg_cache;
+	jit_node_t *to_next, *to_end[3];
+	unsigned int align;
+	u8 tmp, val;
+
+	/* The callers already hold up to four registers; branch on the
+	 * alignment so that each case works with constant shifts and masks,
+	 * and two temporaries. The aligned word is addressed with an offset
+	 * from addr_reg, which is left untouched. */
+	tmp = lightrec_alloc_reg_temp(reg_cache, _jit);
+	val = lightrec_alloc_reg_temp(reg_cache, _jit);
+
+	jit_addi(tmp, addr_reg, imm);
+	jit_andi(tmp, tmp, 3);
+
+	for (align = 0; align < 3; align++) {
+		to_next = jit_bnei(tmp, align);
+		rec_store_partial_aligned(_jit, c, addr_reg, imm, src_reg,
+					  tmp, val, align);
+		to_end[align] = jit_b();
+		jit_patch(to_next);
+	}
+
+	rec_store_partial_aligned(_jit, c, addr_reg, imm, src_reg,
+				  tmp, val, 3);
+
+	for (align = 0; align < 3; align++)
+		jit_patch(to_end[align]);
+
+	lightrec_free_reg(reg_cache, tmp);
+	lightrec_free_reg(reg_cache, val);
+}
+
 static void rec_store_memory(struct lightrec_cstate *cstate,
 			     const struct block *block,
 			     u16 offset, jit_code_t code,
@@ -1355,6 +1530,8 @@ static void rec_store_memory(struct lightrec_cstate *cstate,
 
 	if (c.i.op == OP_META_SWU)
 		jit_unstr(addr_reg2, src_reg, LIGHTNING_UNALIGNED_32BIT);
+	else if (opcode_is_partial(c))
+		rec_store_partial(cstate, _jit, c, addr_reg2, imm, src_reg);
 	else
 		jit_new_node_www(code, imm, addr_reg2, src_reg);
 
@@ -1426,6 +1603,8 @@ static void rec_store_io(struct lightrec_cstate *cstate,
 {
 	_jit_note(block->_jit, __FILE__, __LINE__);
 
+	/* SWL/SWR to direct hardware registers are emitted inline as well,
+	 * as a read-modify-write of the aligned word. */
 	return rec_store_memory(cstate, block, offset, code, swap_code,
 				cstate->state->offset_io,
 				rec_io_mask(cstate->state), false);
@@ -1500,6 +1679,8 @@ static void rec_store_direct_no_invalidate(struct lightrec_cstate *cstate,
 
 	if (c.i.op == OP_META_SWU)
 		jit_unstr(tmp, src_reg, LIGHTNING_UNALIGNED_32BIT);
+	else if (opcode_is_partial(c))
+		rec_store_partial(cstate, _jit, c, tmp, imm, src_reg);
 	else
 		jit_new_node_www(code, imm, tmp, src_reg);
 
@@ -1611,6 +1792,8 @@ static void rec_store_direct(struct lightrec_cstate *cstate, const struct block
 
 	if (c.i.op == OP_META_SWU)
 		jit_unstr(tmp2, src_reg, LIGHTNING_UNALIGNED_32BIT);
+	else if (opcode_is_partial(c))
+		rec_store_partial(cstate, _jit, c, tmp2, 0, src_reg);
 	else
 		jit_new_node_www(code, 0, tmp2, src_reg);
 
@@ -1618,6 +1801,78 @@ static void rec_store_direct(struct lightrec_cstate *cstate, const struct block
 	lightrec_free_reg(reg_cache, tmp2);
 }
 
+static void rec_store_fifo(struct lightrec_cstate *cstate,
+			   const struct block *block, u16 offset)
+{
+	const struct lightrec_state *state = cstate->state;
+	const struct lightrec_fifo *fifo = state->ops.fifo;
+	struct regcache *reg_cache = cstate->reg_cache;
+	union code c = block->opcode_list[offset].c;
+	jit_state_t *_jit = block->_jit;
+	struct native_register *regs_backup;
+	jit_node_t *to_slow, *to_end;
+	u8 rt, tmp, tmp2, r1;
+	s8 wrapper;
+
+	jit_note(__FILE__, __LINE__);
+
+	/* The slow path calls the C wrapper, which reads rs and rt from the
+	 * state, uses JIT_R1, and needs the wrapper's address in a register.
+	 * Set all of this up before branching, so that the register cache is
+	 * in the same state at the end of both paths. */
+	lightrec_clean_reg_if_loaded(reg_cache, _jit, c.i.rs, false);
+	lightrec_clean_reg_if_loaded(reg_cache, _jit, c.i.rt, false);
+
+	r1 = lightrec_alloc_reg(reg_cache, _jit, JIT_R1);
+#ifdef __mips__
+	lightrec_unload_reg(reg_cache, _jit, _T9);
+#endif
+
+	wrapper = lightrec_get_reg_with_value(reg_cache,
+					      (intptr_t) state->c_wrapper);
+	if (wrapper < 0) {
+		wrapper = lightrec_alloc_reg_temp(reg_cache, _jit);
+		jit_ldxi(wrapper, LIGHTREC_REG_STATE, lightrec_offset(c_wrapper));
+
+		lightrec_temp_set_value(reg_cache, wrapper,
+					(intptr_t) state->c_wrapper);
+	}
+
+	rt = lightrec_alloc_reg_in(reg_cache, _jit, c.i.rt, 0);
+	tmp = lightrec_alloc_reg_temp(reg_cache, _jit);
+	tmp2 = lightrec_alloc_reg_temp(reg_cache, _jit);
+
+	jit_movi(tmp2, (uintptr_t) fifo->len);
+	jit_ldxi_i(tmp, tmp2, 0);
+
+	/* Leave the last slot to the slow path, which will flush the buffer
+	 * once it's full. */
+	to_slow = jit_bgei(tmp, fifo->size - 1);
+
+	jit_addi(tmp, tmp, 1);
+	jit_stxi_i(0, tmp2, tmp);
+
+	jit_lshi(tmp, tmp, 2);
+	jit_movi(tmp2, (uintptr_t) fifo->buffer);
+	jit_addr(tmp, tmp, tmp2);
+	jit_stxi_i(-4, tmp, rt);
+
+	lightrec_free_reg(reg_cache, tmp2);
+	lightrec_free_reg(reg_cache, tmp);
+	lightrec_free_reg(reg_cache, rt);
+	lightrec_free_reg(reg_cache, wrapper);
+	lightrec_free_reg(reg_cache, r1);
+
+	to_end = jit_b();
+	jit_patch(to_slow);
+
+	regs_backup = lightrec_regcache_enter_branch(reg_cache);
+	call_to_c_wrapper(cstate, block, c.opcode, C_WRAPPER_RW);
+	lightrec_regcache_leave_branch(reg_cache, regs_backup);
+
+	jit_patch(to_end);
+}
+
 static void rec_store(struct lightrec_cstate *state,
 		      const struct block *block, u16 offset,
 		      jit_code_t code, jit_code_t swap_code)
@@ -1661,6 +1916,9 @@ static void rec_store(struct lightrec_cstate *state,
 	case LIGHTREC_IO_DIRECT_HW:
 		rec_store_io(state, block, offset, code, swap_code);
 		break;
+	case LIGHTREC_IO_FIFO:
+		rec_store_fifo(state, block, offset);
+		break;
 	default:
 		rec_io(state, block, offset, true, false);
 		return;
@@ -1700,14 +1958,14 @@ static void rec_SWL(struct lightrec_cstate *state,
 		    const struct block *block, u16 offset)
 {
 	_jit_name(block->_jit, __func__);
-	rec_io(state, block, offset, true, false);
+	rec_store(state, block, offset, jit_code_stxi_i, 0);
 }
 
 static void rec_SWR(struct lightrec_cstate *state,
 		    const struct block *block, u16 offset)
 {
 	_jit_name(block->_jit, __func__);
-	rec_io(state, block, offset, true, false);
+	rec_store(state, block, offset, jit_code_stxi_i, 0);
 }
 
 static void rec_load_memory(struct lightrec_cstate *cstate,
@@ -1720,7 +1978,7 @@ static void rec_load_memory(struct lightrec_cstate *cstate,
 	struct opcode *op = &block->opcode_list[offset];
 	bool load_delay = op_flag_load_delay(op->flags) && !cstate->no_load_delay;
 	jit_state_t *_jit = block->_jit;
-	u8 rs, rt, out_reg, addr_reg, flags = REG_EXT;
+	u8 rs, rt, out_reg, addr_reg, old = 0, flags = REG_EXT;
 	bool no_mask = op_flag_no_mask(op->flags);
 	union code c = op->c;
 	s16 imm;
@@ -1736,6 +1994,8 @@ static void rec_load_memory(struct lightrec_cstate *cstate,
 		flags |= REG_ZEXT;
 
 	rs = lightrec_alloc_reg_in(reg_cache, _jit, c.i.rs, 0);
+	if (opcode_is_partial(c))
+		old = rec_alloc_partial_old(reg_cache, _jit, c);
 	rt = lightrec_alloc_reg_out(reg_cache, _jit, out_reg, flags);
 
 	if ((op->i.op == OP_META_LWU && c.i.imm)
@@ -1761,7 +2021,12 @@ static void rec_load_memory(struct lightrec_cstate *cstate,
 		addr_reg = rt;
 	}
 
-	jit_new_node_www(code, rt, addr_reg, imm);
+	if (opcode_is_partial(c)) {
+		rec_load_partial(cstate, _jit, c, rt, addr_reg, imm, old);
+		lightrec_free_reg(reg_cache, old);
+	} else {
+		jit_new_node_www(code, rt, addr_reg, imm);
+	}
 
 	if (is_big_endian() && swap_code) {
 		jit_new_node_ww(swap_code, rt, rt);
@@ -1812,6 +2077,8 @@ static void rec_load_io(struct lightrec_cstate *cstate,
 {
 	_jit_note(block->_jit, __FILE__, __LINE__);
 
+	/* LWL/LWR from direct hardware registers are emitted inline as well;
+	 * only untagged accesses go through the C wrapper. */
 	rec_load_memory(cstate, block, offset, code, swap_code, is_unsigned,
 			cstate->state->offset_io, rec_io_mask(cstate->state));
 }
@@ -1826,9 +2093,10 @@ static void rec_load_direct(struct lightrec_cstate *cstate,
 	struct opcode *op = &block->opcode_list[offset];
 	bool load_delay = op_flag_load_delay(op->flags) && !cstate->no_load_delay;
 	jit_state_t *_jit = block->_jit;
-	jit_node_t *to_not_ram, *to_not_bios, *to_end, *to_end2;
-	u8 tmp, rs, rt, out_reg, addr_reg, flags = REG_EXT;
+	jit_node_t *to_not_ram, *to_not_bios, *to_not_scratch, *to_end, *to_end2, *to_end3;
+	u8 tmp, rs, rt, out_reg, addr_reg, old = 0, flags = REG_EXT;
 	bool different_offsets = state->offset_bios != state->offset_scratch;
+	bool scratch_first = op_flag_scratch_hint(op->flags);
 	union code c = op->c;
 	s32 addr_mask;
 	u32 reg_imm;
@@ -1847,6 +2115,8 @@ static void rec_load_direct(struct lightrec_cstate *cstate,
 
 	jit_note(__FILE__, __LINE__);
 	rs = lightrec_alloc_reg_in(reg_cache, _jit, c.i.rs, 0);
+	if (opcode_is_partial(c))
+		old = rec_alloc_partial_old(reg_cache, _jit, c);
 	rt = lightrec_alloc_reg_out(reg_cache, _jit, out_reg, flags);
 
 	if ((state->offset_ram == state->offset_bios &&
@@ -1902,6 +2172,25 @@ static void rec_load_direct(struct lightrec_cstate *cstate,
 			}
 		}
 	} else {
+		if (scratch_first) {
+			/* This opcode was seen accessing the scratchpad, so
+			 * test for it first; the RAM/BIOS checks below are
+			 * only reached when the guess was wrong. */
+			jit_andi(tmp, addr_reg, 0x1fc00000);
+			to_not_scratch = jit_bnei(tmp, 0x1f800000);
+
+			/* Convert to KUNSEG */
+			jit_andi(rt, addr_reg, 0x1f800fff);
+
+			jit_movi(tmp, state->offset_scratch);
+
+			to_end3 = jit_b();
+
+			jit_patch(to_not_scratch);
+
+			cstate->nb_scratch_ops++;
+		}
+
 		to_not_ram = jit_bmsi(addr_reg, BIT(28));
 
 		/* Convert to KUNSEG and avoid RAM mirrors */
@@ -1937,12 +2226,20 @@ static void rec_load_direct(struct lightrec_cstate *cstate,
 		}
 
 		jit_patch(to_end);
+
+		if (scratch_first)
+			jit_patch(to_end3);
 	}
 
 	if (state->offset_ram || state->offset_bios || state->offset_scratch)
 		jit_addr(rt, rt, tmp);
 
-	jit_new_node_www(code, rt, rt, imm);
+	if (opcode_is_partial(c)) {
+		rec_load_partial(cstate, _jit, c, rt, rt, imm, old);
+		lightrec_free_reg(reg_cache, old);
+	} else {
+		jit_new_node_www(code, rt, rt, imm);
+	}
 
 	if (is_big_endian() && swap_code) {
 		jit_new_node_ww(swap_code, rt, rt);
@@ -1998,9 +2295,34 @@ static void rec_LB(struct lightrec_cstate *state, const struct block *block, u16
 	rec_load(state, block, offset, jit_code_ldxi_c, 0, false);
 }
 
+static void rec_fifo_loop(struct lightrec_cstate *state,
+			  const struct block *block, u16 offset)
+{
+	u32 flags = block->opcode_list[offset].flags;
+	struct lightrec_fifo_loop loop;
+	jit_state_t *_jit = block->_jit;
+	u32 lut_entry;
+
+	/* The C wrapper reads and updates the loop's registers in the state
+	 * directly, which is only valid at a branch target, where the
+	 * register cache was just written back and reset. */
+	if (!state->state->ops.read_fifo || !op_flag_sync(flags)
+	    || LIGHTREC_FLAGS_GET_IO_MODE(flags) != LIGHTREC_IO_HW
+	    || !lightrec_get_fifo_loop(block, offset, &loop))
+		return;
+
+	pr_debug("Loop at offset 0x%hx may read a FIFO\n", offset << 2);
+	jit_note(__FILE__, __LINE__);
+
+	lut_entry = lightrec_get_lut_entry(block);
+	call_to_c_wrapper(state, block, (lut_entry << 16) | offset,
+			  C_WRAPPER_FIFO_LOOP);
+}
+
 static void rec_LBU(struct lightrec_cstate *state, const struct block *block, u16 offset)
 {
 	_jit_name(block->_jit, __func__);
+	rec_fifo_loop(state, block, offset);
 	rec_load(state, block, offset, jit_code_ldxi_uc, 0, true);
 }
 
@@ -2021,13 +2343,13 @@ static void rec_LHU(struct lightrec_cstate *state, const struct block *block, u1
 static void rec_LWL(struct lightrec_cstate *state, const struct block *block, u16 offset)
 {
 	_jit_name(block->_jit, __func__);
-	rec_io(state, block, offset, true, true);
+	rec_load(state, block, offset, jit_code_ldxi_i, 0, false);
 }
 
 static void rec_LWR(struct lightrec_cstate *state, const struct block *block, u16 offset)
 {
 	_jit_name(block->_jit, __func__);
-	rec_io(state, block, offset, true, true);
+	rec_load(state, block, offset, jit_code_ldxi_i, 0, false);
 }
 
 static void rec_LW(struct lightrec_cstate *state, const struct block *block, u16 offset)
@@ -2157,9 +2479,12 @@ rec_mtc0(struct lightrec_cstate *state, const struct block *block, u16 offset)
 {
 	struct regcache *reg_cache = state->reg_cache;
 	const union code c = block->opcode_list[offset].c;
+	const struct lightrec_mem_map *io_map;
 	jit_state_t *_jit = block->_jit;
-	u8 rt, tmp = 0, tmp2, status;
+	u8 rt, tmp = 0, tmp2, tmp3, tmp4, status;
 	jit_node_t *to_end;
+	bool sr_or_cause = c.r.rd == 12 || c.r.rd == 13;
+	u32 old_cycles;
 
 	jit_note(__FILE__, __LINE__);
 
@@ -2189,7 +2514,7 @@ rec_mtc0(struct lightrec_cstate *state, const struct block *block, u16 offset)
 	if (c.r.rd != 13)
 		jit_stxi_i(lightrec_offset(regs.cp0[c.r.rd]), LIGHTREC_REG_STATE, rt);
 
-	if (c.r.rd == 12 || c.r.rd == 13) {
+	if (sr_or_cause) {
 		tmp = lightrec_alloc_reg_temp(reg_cache, _jit);
 		jit_ldxi_i(tmp, LIGHTREC_REG_STATE, lightrec_offset(regs.cp0[13]));
 
@@ -2209,7 +2534,7 @@ rec_mtc0(struct lightrec_cstate *state, const struct block *block, u16 offset)
 		status = tmp2;
 	}
 
-	if (c.r.rd == 12 || c.r.rd == 13) {
+	if (sr_or_cause) {
 		/* Exit dynarec in case there's a software interrupt.
 		 * exit_flags = !!(status & tmp & 0x0300) & status; */
 		jit_andr(tmp, tmp, status);
@@ -2225,12 +2550,34 @@ rec_mtc0(struct lightrec_cstate *state, const struct block *block, u16 offset)
 		jit_comr(tmp2, status);
 		jit_andi(tmp2, tmp2, 0x401);
 		jit_eqi(tmp2, tmp2, 0);
+
+		io_map = &state->state->maps[PSX_MAP_HW_REGISTERS];
+
+		if (io_map->address) {
+			/* Only exit if one of the unmasked interrupts is
+			 * actually pending, so that critical sections toggling
+			 * IEc do not end the block.
+			 * exit_flags &= !!(I_STAT & I_MASK) */
+			tmp3 = lightrec_alloc_reg_temp(reg_cache, _jit);
+			tmp4 = lightrec_alloc_reg_temp(reg_cache, _jit);
+
+			jit_movi(tmp3, (uintptr_t)io_map->address + 0x70);
+			jit_ldxi_i(tmp4, tmp3, 0);
+			jit_ldxi_i(tmp3, tmp3, 4);
+			jit_andr(tmp3, tmp3, tmp4);
+			jit_nei(tmp3, tmp3, 0);
+			jit_andr(tmp2, tmp2, tmp3);
+
+			lightrec_free_reg(reg_cache, tmp4);
+			lightrec_free_reg(reg_cache, tmp3);
+		}
+
 		jit_orr(tmp, tmp, tmp2);
 	}
 
 	lightrec_free_reg(reg_cache, rt);
 
-	if (c.r.rd == 12 || c.r.rd == 13) {
+	if (sr_or_cause) {
 		to_end = jit_beqi(tmp, 0);
 
 		jit_ldxi_i(tmp2, LIGHTREC_REG_STATE, lightrec_offset(target_cycle));
@@ -2239,14 +2586,26 @@ rec_mtc0(struct lightrec_cstate *state, const struct block *block, u16 offset)
 		jit_stxi_i(lightrec_offset(target_cycle), LIGHTREC_REG_STATE, tmp2);
 		jit_stxi_i(lightrec_offset(current_cycle), LIGHTREC_REG_STATE, tmp2);
 
+		lightrec_free_reg(reg_cache, tmp);
+		lightrec_free_reg(reg_cache, tmp2);
 
-		jit_patch(to_end);
-	}
+		if (!op_flag_no_ds(block->opcode_list[offset].flags)) {
+			/* An interrupt is pending: leave the block right
+			 * after this opcode, so that it is handled. Otherwise
+			 * keep running the rest of the block. */
+			struct native_register *regs_backup;
+
+			regs_backup = lightrec_regcache_enter_branch(reg_cache);
 
-	if (!op_flag_no_ds(block->opcode_list[offset].flags) &&
-	    (c.r.rd == 12 || c.r.rd == 13)) {
-		state->cycles += lightrec_cycles_of_opcode(state->state, c);
-		lightrec_emit_eob(state, block, offset + 1);
+			old_cycles = state->cycles;
+			state->cycles += lightrec_cycles_of_opcode(state->state, c);
+			lightrec_emit_eob(state, block, offset + 1);
+			state->cycles = old_cycles;
+
+			lightrec_regcache_leave_branch(reg_cache, regs_backup);
+		}
+
+		jit_patch(to_end);
 	}
 }
 
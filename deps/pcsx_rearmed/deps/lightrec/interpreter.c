@@ -13,17 +13,33 @@
 
 struct interpreter;
 
-static u32 int_CP0(struct interpreter *inter);
-static u32 int_CP2(struct interpreter *inter);
-static u32 int_SPECIAL(struct interpreter *inter);
-static u32 int_META(struct interpreter *inter);
-static u32 int_REGIMM(struct interpreter *inter);
+static u32 int_resolve_handler(struct opcode *op);
 static u32 int_branch(struct interpreter *inter, u32 pc,
 		      union code code, bool branch);
 
 typedef u32 (*lightrec_int_func_t)(struct interpreter *inter);
 
-static const lightrec_int_func_t int_standard[64];
+/* The handler of each opcode is resolved once, and cached in its flags as
+ * (table << 6 | index) so that the next visits dispatch with a single
+ * lookup. Zero means that the opcode wasn't resolved yet. */
+enum int_table {
+	INT_TABLE_NONE,
+	INT_TABLE_STANDARD,
+	INT_TABLE_SPECIAL,
+	INT_TABLE_REGIMM,
+	INT_TABLE_CP0,
+	INT_TABLE_CP2_BASIC,
+	INT_TABLE_META,
+	INT_TABLE_FALLBACK,
+	INT_TABLE_COUNT,
+};
+
+enum int_fallback {
+	INT_FALLBACK_UNIMPLEMENTED,
+	INT_FALLBACK_CP,
+};
+
+static const lightrec_int_func_t * const int_tables[INT_TABLE_COUNT];
 
 struct interpreter {
 	struct lightrec_state *state;
@@ -57,7 +73,15 @@ static inline u32 execute(lightrec_int_func_t func, struct interpreter *inter)
 
 static inline u32 lightrec_int_op(struct interpreter *inter)
 {
-	return execute(int_standard[inter->op->i.op], inter);
+	u32 handler = LIGHTREC_FLAGS_GET_INT_HANDLER(inter->op->flags);
+
+	if (ENABLE_STATS)
+		inter->state->nb_int_ops++;
+
+	if (unlikely(!handler))
+		handler = int_resolve_handler(inter->op);
+
+	return execute(int_tables[handler >> 6][handler & 0x3f], inter);
 }
 
 static inline u32 jump_skip(struct interpreter *inter)
@@ -490,18 +514,46 @@ static u32 int_cfc(struct interpreter *inter)
 	return jump_next(inter);
 }
 
+static bool int_mtc0_irq_pending(struct lightrec_state *state, u8 reg)
+{
+	const struct lightrec_mem_map *io_map;
+	u32 status = state->regs.cp0[12], cause = state->regs.cp0[13];
+	const u32 *io;
+
+	/* Software interrupt */
+	if ((!!(status & cause & 0x300)) & status)
+		return true;
+
+	/* Unmasked hardware interrupt. Same check as rec_mtc0(): only if one
+	 * is actually pending in I_STAT & I_MASK. */
+	if (reg != 12 || (~status & 0x401))
+		return false;
+
+	io_map = &state->maps[PSX_MAP_HW_REGISTERS];
+	if (!io_map->address)
+		return true;
+
+	io = (const u32 *)((uintptr_t)io_map->address + 0x70);
+
+	return !!(LE32TOH(io[0]) & LE32TOH(io[1]));
+}
+
 static u32 int_ctc(struct interpreter *inter)
 {
 	struct lightrec_state *state = inter->state;
 	const struct opcode *op = inter->op;
+	u32 old_status = state->regs.cp0[12];
+	bool sr_or_cause = op->i.op == OP_CP0 && (op->r.rd == 12 || op->r.rd == 13);
 
 	lightrec_mtc(state, op->c, op->r.rd, state->regs.gpr[op->r.rt]);
 
 	/* If we have a MTC0 or CTC0 to CP0 register 12 (Status) or 13 (Cause),
-	 * return early so that the emulator will be able to check software
-	 * interrupt status. */
-	if (!op_flag_no_ds(inter->op->flags) &&
-	    op->i.op == OP_CP0 && (op->r.rd == 12 || op->r.rd == 13))
+	 * return early if an interrupt is now pending, so that the emulator
+	 * will handle it; otherwise keep running the block, as the emitted
+	 * code does. Toggling the cache isolation bit always ends the block. */
+	if (!op_flag_no_ds(inter->op->flags) && sr_or_cause &&
+	    (((old_status ^ state->regs.cp0[12]) & BIT(16))
+	     || int_mtc0_irq_pending(state, op->r.rd)))
 		return int_get_ds_pc(inter, 1);
 	else
 		return jump_next(inter);
@@ -1031,8 +1083,6 @@ static u32 int_META_COM(struct interpreter *inter)
 
 static const lightrec_int_func_t int_standard[64] = {
 	SET_DEFAULT_ELM(int_standard, int_unimplemented),
-	[OP_SPECIAL]		= int_SPECIAL,
-	[OP_REGIMM]		= int_REGIMM,
 	[OP_J]			= int_J,
 	[OP_JAL]		= int_JAL,
 	[OP_BEQ]		= int_BEQ,
@@ -1047,8 +1097,6 @@ static const lightrec_int_func_t int_standard[64] = {
 	[OP_ORI]		= int_ORI,
 	[OP_XORI]		= int_XORI,
 	[OP_LUI]		= int_LUI,
-	[OP_CP0]		= int_CP0,
-	[OP_CP2]		= int_CP2,
 	[OP_LB]			= int_load,
 	[OP_LH]			= int_load,
 	[OP_LWL]		= int_load,
@@ -1064,7 +1112,6 @@ static const lightrec_int_func_t int_standard[64] = {
 	[OP_LWC2]		= int_LWC2,
 	[OP_SWC2]		= int_store,
 
-	[OP_META]		= int_META,
 	[OP_META_MULT2]		= int_META_MULT2,
 	[OP_META_MULTU2]	= int_META_MULT2,
 	[OP_META_LWU]		= int_load,
@@ -1136,55 +1183,66 @@ static const lightrec_int_func_t int_meta[64] = {
 	[OP_META_COM]		= int_META_COM,
 };
 
-static u32 int_SPECIAL(struct interpreter *inter)
-{
-	lightrec_int_func_t f = int_special[inter->op->r.op];
-
-	if (!HAS_DEFAULT_ELM && unlikely(!f))
-		return int_unimplemented(inter);
+static const lightrec_int_func_t int_fallback[] = {
+	[INT_FALLBACK_UNIMPLEMENTED]	= int_unimplemented,
+	[INT_FALLBACK_CP]		= int_CP,
+};
 
-	return execute(f, inter);
-}
+static const lightrec_int_func_t * const int_tables[INT_TABLE_COUNT] = {
+	[INT_TABLE_STANDARD]	= int_standard,
+	[INT_TABLE_SPECIAL]	= int_special,
+	[INT_TABLE_REGIMM]	= int_regimm,
+	[INT_TABLE_CP0]		= int_cp0,
+	[INT_TABLE_CP2_BASIC]	= int_cp2_basic,
+	[INT_TABLE_META]	= int_meta,
+	[INT_TABLE_FALLBACK]	= int_fallback,
+};
 
-static u32 int_REGIMM(struct interpreter *inter)
+static u32 int_handler(enum int_table table, u8 idx, enum int_fallback fallback)
 {
-	lightrec_int_func_t f = int_regimm[inter->op->r.rt];
-
-	if (!HAS_DEFAULT_ELM && unlikely(!f))
-		return int_unimplemented(inter);
+	if (!HAS_DEFAULT_ELM && unlikely(!int_tables[table][idx]))
+		return INT_TABLE_FALLBACK << 6 | fallback;
 
-	return execute(f, inter);
+	return table << 6 | idx;
 }
 
-static u32 int_CP0(struct interpreter *inter)
+static u32 int_resolve_handler(struct opcode *op)
 {
-	lightrec_int_func_t f = int_cp0[inter->op->r.rs];
-
-	if (!HAS_DEFAULT_ELM && unlikely(!f))
-		return int_CP(inter);
+	union code c = op->c;
+	u32 handler;
 
-	return execute(f, inter);
-}
-
-static u32 int_CP2(struct interpreter *inter)
-{
-	if (inter->op->r.op == OP_CP2_BASIC) {
-		lightrec_int_func_t f = int_cp2_basic[inter->op->r.rs];
-		if (HAS_DEFAULT_ELM || likely(f))
-			return execute(f, inter);
+	switch (c.i.op) {
+	case OP_SPECIAL:
+		handler = int_handler(INT_TABLE_SPECIAL, c.r.op,
+				      INT_FALLBACK_UNIMPLEMENTED);
+		break;
+	case OP_REGIMM:
+		handler = int_handler(INT_TABLE_REGIMM, c.r.rt,
+				      INT_FALLBACK_UNIMPLEMENTED);
+		break;
+	case OP_CP0:
+		handler = int_handler(INT_TABLE_CP0, c.r.rs, INT_FALLBACK_CP);
+		break;
+	case OP_CP2:
+		if (c.r.op == OP_CP2_BASIC)
+			handler = int_handler(INT_TABLE_CP2_BASIC, c.r.rs,
+					      INT_FALLBACK_CP);
+		else
+			handler = INT_TABLE_FALLBACK << 6 | INT_FALLBACK_CP;
+		break;
+	case OP_META:
+		handler = int_handler(INT_TABLE_META, c.m.op,
+				      INT_FALLBACK_UNIMPLEMENTED);
+		break;
+	default:
+		handler = int_handler(INT_TABLE_STANDARD, c.i.op,
+				      INT_FALLBACK_UNIMPLEMENTED);
+		break;
 	}
 
-	return int_CP(inter);
-}
-
-static u32 int_META(struct interpreter *inter)
-{
-	lightrec_int_func_t f = int_meta[inter->op->m.op];
-
-	if (!HAS_DEFAULT_ELM && unlikely(!f))
-		return int_unimplemented(inter);
+	op->flags |= LIGHTREC_INT_HANDLER(handler);
 
-	return execute(f, inter);
+	return handler;
 }
 
 static u32 lightrec_emulate_block_list(struct lightrec_state *state,
@@ -147,6 +147,7 @@ enum c_wrappers {
 	C_WRAPPER_MFC,
 	C_WRAPPER_MTC,
 	C_WRAPPER_CP,
+	C_WRAPPER_FIFO_LOOP,
 	C_WRAPPERS_COUNT,
 };
 
@@ -159,6 +160,7 @@ struct lightrec_cstate {
 	unsigned int nb_local_branches;
 	unsigned int nb_targets;
 	unsigned int cycles;
+	unsigned int nb_scratch_ops;
 
 	struct regcache *reg_cache;
 
@@ -185,6 +187,7 @@ struct lightrec_state {
 	struct lightrec_cstate *cstate;
 	struct reaper *reaper;
 	void *tlsf;
+	void *freed_code;
 	void (*eob_wrapper_func)(void);
 	void (*interpreter_func)(void);
 	void (*ds_check_func)(void);
@@ -193,6 +196,7 @@ struct lightrec_state {
 	struct lightrec_ops ops;
 	unsigned int nb_precompile;
 	unsigned int nb_compile;
+	unsigned int nb_int_ops;
 	unsigned int nb_maps;
 	const struct lightrec_mem_map *maps;
 	uintptr_t offset_ram, offset_bios, offset_scratch, offset_io;
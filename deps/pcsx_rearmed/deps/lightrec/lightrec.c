@@ -37,6 +37,7 @@ static void lightrec_mtc2(struct lightrec_state *state, u8 reg, u32 data);
 static u32 lightrec_mfc2(struct lightrec_state *state, u8 reg);
 
 static void lightrec_reap_block(struct lightrec_state *state, void *data);
+static void lightrec_release_code(struct lightrec_state *state);
 
 static void lightrec_default_sb(struct lightrec_state *state, u32 opcode,
 				void *host, u32 addr, u32 data)
@@ -299,6 +300,11 @@ u32 lightrec_rw(struct lightrec_state *state, union code op, u32 base,
 				*flags |= LIGHTREC_IO_MODE(LIGHTREC_IO_HW);
 			else
 				*flags |= LIGHTREC_IO_MODE(LIGHTREC_IO_DIRECT);
+
+			/* Remember that this access hit the scratchpad, so that
+			 * the direct-I/O emitters test for it first. */
+			if (map == &state->maps[PSX_MAP_SCRATCH_PAD])
+				*flags |= LIGHTREC_SCRATCH_HINT;
 		}
 
 		ops = &lightrec_default_ops;
@@ -420,6 +426,83 @@ static void lightrec_rw_generic_cb(struct lightrec_state *state, u32 arg)
 	lightrec_rw_helper(state, op->c, &op->flags, block, offset);
 }
 
+static void lightrec_fifo_loop_cb(struct lightrec_state *state, u32 arg)
+{
+	const struct lightrec_read_fifo *fifo = state->ops.read_fifo;
+	const struct lightrec_mem_map *map;
+	struct lightrec_fifo_loop loop;
+	u32 *gpr = state->regs.gpr;
+	u32 addr, count, max, cycles = 0;
+	struct block *block;
+	u16 i, offset = (u16)arg;
+	union code head;
+	void *host;
+
+	block = lightrec_find_block_from_lut(state->block_cache,
+					     arg >> 16, state->curr_pc);
+	if (unlikely(!block)) {
+		pr_err("fifo_loop: No block found in LUT for "PC_FMT" offset 0x%"PRIx16"\n",
+		       state->curr_pc, offset);
+		return;
+	}
+
+	if (!lightrec_get_fifo_loop(block, offset, &loop))
+		return;
+
+	head = block->opcode_list[offset].c;
+	if (kunseg(gpr[head.i.rs] + (s16)head.i.imm) != fifo->kaddr)
+		return;
+
+	/* Run all the iterations but the last one, which is left to the
+	 * regular code so that it exits the loop. */
+	count = gpr[loop.end] - gpr[loop.cnt] - (loop.cnt_pre ? loop.cnt_step : 0);
+	if (loop.cnt_step < 0)
+		count = -count;
+
+	/* Don't go past the cycle budget: the loop's branch would have
+	 * returned to the dispatcher there. */
+	for (i = offset; i <= loop.last; i++)
+		cycles += lightrec_cycles_of_opcode(state, block->opcode_list[i].c);
+
+	if (state->current_cycle >= state->target_cycle)
+		return;
+
+	max = state->target_cycle - state->current_cycle - 1;
+	if (cycles)
+		max /= cycles;
+	if (count > max)
+		count = max;
+
+	addr = kunseg(gpr[loop.ptr] + loop.dst_off);
+	map = lightrec_get_map(state, &host, addr);
+	if (map != &state->maps[PSX_MAP_KERNEL_USER_RAM] || map->ops)
+		return;
+
+	max = RAM_SIZE - (addr & (RAM_SIZE - 1));
+	if (count > max)
+		count = max;
+
+	if (count < 2)
+		return;
+
+	count = fifo->read(state, host, count);
+	if (!count)
+		return;
+
+	pr_debug("FIFO loop at "PC_FMT": %"PRIu32" bytes to "PC_FMT"\n",
+		 block->pc + (offset << 2), count, addr);
+
+	if (!(state->opt_flags & LIGHTREC_OPT_INV_DMA_ONLY))
+		lightrec_invalidate_map(state, map, addr, count);
+
+	gpr[head.i.rt] = ((u8 *)host)[count - 1];
+	gpr[loop.ptr] += count;
+	if (loop.cnt != loop.ptr)
+		gpr[loop.cnt] += loop.cnt_step < 0 ? -count : count;
+
+	state->current_cycle += count * cycles;
+}
+
 static u32 clamp_s32(s32 val, s32 min, s32 max)
 {
 	return val < min ? min : val > max ? max : val;
@@ -741,6 +824,10 @@ static void * get_next_block_func(struct lightrec_state *state, u32 pc)
 	void *func;
 	int err;
 
+	/* We're back in C, with no block running: the memory of the blocks
+	 * freed in the meantime can be reused. */
+	lightrec_release_code(state);
+
 	do {
 		func = lut_read(state, lut_offset(pc));
 		if (func && func != state->get_next_block)
@@ -853,7 +940,48 @@ static void lightrec_free_code(struct lightrec_state *state, void *ptr)
 	if (ENABLE_THREADED_COMPILER)
 		lightrec_code_alloc_lock(state);
 
-	tlsf_free(state->tlsf, ptr);
+	if (state->ops.code_inv_all) {
+		/* The instruction cache may still hold lines of the old code.
+		 * Keep the memory aside until lightrec_release_code() drops
+		 * them all at once. */
+		*(void **)ptr = state->freed_code;
+		state->freed_code = ptr;
+	} else {
+		tlsf_free(state->tlsf, ptr);
+	}
+
+	if (ENABLE_THREADED_COMPILER)
+		lightrec_code_alloc_unlock(state);
+}
+
+static void lightrec_release_code(struct lightrec_state *state)
+{
+	void *ptr, *next;
+
+	if (likely(!state->freed_code))
+		return;
+
+	if (ENABLE_THREADED_COMPILER)
+		lightrec_code_alloc_lock(state);
+
+	ptr = state->freed_code;
+	state->freed_code = NULL;
+
+	if (ENABLE_THREADED_COMPILER)
+		lightrec_code_alloc_unlock(state);
+
+	/* None of the freed code can run anymore, and new code is only
+	 * emitted to memory that was not used since the last call, so one
+	 * instruction cache invalidation covers all the freed blocks. */
+	state->ops.code_inv_all();
+
+	if (ENABLE_THREADED_COMPILER)
+		lightrec_code_alloc_lock(state);
+
+	for (; ptr; ptr = next) {
+		next = *(void **)ptr;
+		tlsf_free(state->tlsf, ptr);
+	}
 
 	if (ENABLE_THREADED_COMPILER)
 		lightrec_code_alloc_unlock(state);
@@ -898,6 +1026,7 @@ static void * lightrec_emit_code(struct lightrec_state *state,
 
 			/* Remove outdated blocks, and try again */
 			lightrec_remove_outdated_blocks(state->block_cache, block);
+			lightrec_release_code(state);
 
 			pr_debug("Re-try to alloc %zu bytes...\n", code_size);
 
@@ -932,10 +1061,38 @@ static void * lightrec_emit_code(struct lightrec_state *state,
 
 	*size = (unsigned int) new_code_size;
 
+	return code;
+}
+
+static void lightrec_code_inv(struct lightrec_state *state,
+			      void *code, unsigned int size)
+{
 	if (state->ops.code_inv)
-		state->ops.code_inv(code, new_code_size);
+		state->ops.code_inv(code, size);
+}
 
-	return code;
+static void lightrec_code_inv_blocks(struct lightrec_state *state,
+				     const struct block *b1,
+				     const struct block *b2)
+{
+	uintptr_t start1 = (uintptr_t) b1->function,
+		  start2 = (uintptr_t) b2->function,
+		  end1 = start1 + b1->code_size,
+		  end2 = start2 + b2->code_size;
+
+	/* Blocks emitted back to back are usually contiguous in the code
+	 * buffer; in that case, invalidate them in one go. */
+	if (start2 <= end1 && start1 <= end2) {
+		if (start2 < start1)
+			start1 = start2;
+		if (end2 > end1)
+			end1 = end2;
+
+		lightrec_code_inv(state, (void *) start1, end1 - start1);
+	} else {
+		lightrec_code_inv(state, b1->function, b1->code_size);
+		lightrec_code_inv(state, b2->function, b2->code_size);
+	}
 }
 
 static struct block * generate_wrapper(struct lightrec_state *state)
@@ -1105,6 +1262,16 @@ static void sync_next_pc(jit_state_t *_jit)
 	}
 }
 
+static void lightrec_service_events(struct lightrec_state *state)
+{
+	if (state->exit_flags == LIGHTREC_EXIT_NORMAL)
+		(*state->ops.service_events)(state);
+
+	/* We may not return to lightrec_execute() for a while */
+	if (ENABLE_THREADED_COMPILER)
+		lightrec_reaper_reap(state->reaper);
+}
+
 static struct block * generate_dispatcher(struct lightrec_state *state)
 {
 	struct block *block;
@@ -1225,6 +1392,20 @@ static struct block * generate_dispatcher(struct lightrec_state *state)
 	/* Store back the current PC to the lightrec_state structure */
 	jit_stxi_i(lightrec_offset(curr_pc), LIGHTREC_REG_STATE, JIT_V0);
 
+	if (state->ops.service_events) {
+		/* Out of cycles - let the emulator service its events, and
+		 * keep going if it gave us a new cycle budget */
+		update_cycle_counter_before_c(_jit);
+
+		jit_prepare();
+		jit_pushargr(LIGHTREC_REG_STATE);
+		jit_finishi(lightrec_service_events);
+
+		update_cycle_counter_after_c(_jit);
+
+		jit_patch_at(jit_bgti(LIGHTREC_REG_CYCLE, 0), loop2);
+	}
+
 	jit_retr(LIGHTREC_REG_CYCLE);
 
 	if (OPT_REPLACE_MEMSET) {
@@ -1368,7 +1549,9 @@ static unsigned int lightrec_get_mips_block_len(const u32 *src)
 	for (i = 1; ; i++) {
 		c.opcode = LE32TOH(*src++);
 
-		if (is_syscall(c))
+		/* Writes to Status/Cause don't end the block; the emitted code
+		 * only exits when an interrupt is actually pending. */
+		if (c.i.op == OP_SPECIAL && c.r.op == OP_SPECIAL_SYSCALL)
 			return i;
 
 		if (is_unconditional_jump(c))
@@ -1592,6 +1775,7 @@ int lightrec_compile_block(struct lightrec_cstate *cstate,
 	cstate->cycles = 0;
 	cstate->nb_local_branches = 0;
 	cstate->nb_targets = 0;
+	cstate->nb_scratch_ops = 0;
 	cstate->no_load_delay = false;
 
 	jit_prolog();
@@ -1664,6 +1848,10 @@ int lightrec_compile_block(struct lightrec_cstate *cstate,
 		return -ENOMEM;
 	}
 
+	/* The new code must be visible to the CPU before it gets published to
+	 * the LUT, as the dispatcher may jump to it right away. */
+	lightrec_code_inv(state, new_fn, block->code_size);
+
 	/* Pause the reaper, because lightrec_reset_lut_offset() may try to set
 	 * the old block->function pointer to the code LUT. */
 	if (ENABLE_THREADED_COMPILER)
@@ -1785,6 +1973,10 @@ int lightrec_compile_block(struct lightrec_cstate *cstate,
 	}
 
 	pr_debug("Blocks compiled: %u\n", ++state->nb_compile);
+	if (cstate->nb_scratch_ops) {
+		pr_debug("Block at "PC_FMT" has %u scratchpad-first loads\n",
+			 block->pc, cstate->nb_scratch_ops);
+	}
 
 	return 0;
 }
@@ -1993,11 +2185,15 @@ struct lightrec_state * lightrec_init(char *argv0,
 	if (!state->c_wrapper_block)
 		goto err_free_dispatcher;
 
+	lightrec_code_inv_blocks(state, state->dispatcher,
+				 state->c_wrapper_block);
+
 	state->c_wrappers[C_WRAPPER_RW] = lightrec_rw_cb;
 	state->c_wrappers[C_WRAPPER_RW_GENERIC] = lightrec_rw_generic_cb;
 	state->c_wrappers[C_WRAPPER_MFC] = lightrec_mfc_cb;
 	state->c_wrappers[C_WRAPPER_MTC] = lightrec_mtc_cb;
 	state->c_wrappers[C_WRAPPER_CP] = lightrec_cp_cb;
+	state->c_wrappers[C_WRAPPER_FIFO_LOOP] = lightrec_fifo_loop_cb;
 
 	map = &maps[PSX_MAP_BIOS];
 	state->offset_bios = (uintptr_t)map->address - map->pc;
@@ -2174,3 +2370,8 @@ void lightrec_set_cycles_per_opcode(struct lightrec_state *state, u32 cycles)
 	if (ENABLE_THREADED_COMPILER)
 		lightrec_recompiler_unpause(state->rec);
 }
+
+unsigned int lightrec_int_op_count(const struct lightrec_state *state)
+{
+	return state->nb_int_ops;
+}
@@ -108,12 +108,41 @@ struct lightrec_mem_map {
 	const struct lightrec_mem_map *mirror_of;
 };
 
+struct lightrec_fifo {
+	u32 kaddr;
+	u32 size;
+	u32 *buffer;
+	s32 *len;
+};
+
+/* Byte-wide FIFO read by hand with LBU loops, which are then run as one
+ * call to read(). It copies up to len bytes to dst, as that many reads of
+ * the port would, and returns the number of bytes copied. */
+struct lightrec_read_fifo {
+	u32 kaddr;
+	u32 (*read)(struct lightrec_state *state, u8 *dst, u32 len);
+};
+
 struct lightrec_ops {
 	void (*cop2_notify)(struct lightrec_state *state, u32 op, u32 data);
 	void (*cop2_op)(struct lightrec_state *state, u32 op);
 	void (*enable_ram)(struct lightrec_state *state, _Bool enable);
 	_Bool (*hw_direct)(u32 kaddr, _Bool is_write, u8 size);
 	void (*code_inv)(void *addr, u32 len);
+
+	/* Optional. If set, code memory freed by Lightrec is set aside, and
+	 * only reused after a call to code_inv_all(), made from the thread
+	 * running lightrec_execute() the next time it goes back to C. It must
+	 * invalidate the whole instruction cache. */
+	void (*code_inv_all)(void);
+	const struct lightrec_fifo *fifo;
+	const struct lightrec_read_fifo *read_fifo;
+
+	/* Called from the dispatcher when the cycle budget runs out. It can
+	 * grant a new budget with lightrec_set_target_cycle_count() to keep
+	 * running in place, or set exit flags to return from
+	 * lightrec_execute(). */
+	void (*service_events)(struct lightrec_state *state);
 };
 
 struct lightrec_registers {
@@ -152,6 +181,8 @@ __api void lightrec_set_target_cycle_count(struct lightrec_state *state,
 					   u32 cycles);
 __api void lightrec_set_cycles_per_opcode(struct lightrec_state *state, u32 cycles);
 
+__api unsigned int lightrec_int_op_count(const struct lightrec_state *state);
+
 #ifdef __cplusplus
 };
 #endif
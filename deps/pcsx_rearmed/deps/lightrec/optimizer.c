@@ -299,6 +299,8 @@ static bool reg_is_dead(const struct opcode *list, unsigned int offset, u8 reg)
 		if (opcode_writes_register(list[i].c, reg))
 			return true;
 
+		/* MTC0/CTC0 to Status or Cause still leave the block when an
+		 * interrupt is pending, so the register must be up to date */
 		if (is_syscall(list[i].c))
 			return false;
 
@@ -1279,6 +1281,124 @@ static bool lightrec_can_switch_delay_slot(union code op, union code next_op)
 	return true;
 }
 
+/* GTE data registers written by a MTC2 or LWC2 to the given register */
+static u32 gte_write_mask(u8 reg)
+{
+	switch (reg) {
+	case 15:
+		return BIT(12) | BIT(13) | BIT(14);
+	case 28:
+		return BIT(9) | BIT(10) | BIT(11);
+	case 30:
+		return BIT(30) | BIT(31);
+	case 31:
+		return 0;
+	default:
+		return BIT(reg);
+	}
+}
+
+/* GTE data registers read by a MFC2 or SWC2 from the given register */
+static u32 gte_read_mask(u8 reg)
+{
+	switch (reg) {
+	case 15:
+		return BIT(14);
+	case 28:
+	case 29:
+		return BIT(9) | BIT(10) | BIT(11);
+	default:
+		return BIT(reg);
+	}
+}
+
+static u32 opcode_gte_reads(union code c)
+{
+	switch (c.i.op) {
+	case OP_CP2:
+		if (c.r.op != OP_CP2_BASIC)
+			return 0xffffffff; /* GTE command */
+
+		if (c.r.rs == OP_CP2_BASIC_MFC2)
+			return gte_read_mask(c.r.rd);
+		if (c.r.rs == OP_CP2_BASIC_MTC2 && c.r.rd == 15)
+			return BIT(13) | BIT(14);
+		return 0;
+	case OP_SWC2:
+		return gte_read_mask(c.i.rt);
+	default:
+		return 0;
+	}
+}
+
+static u32 opcode_gte_writes(union code c)
+{
+	switch (c.i.op) {
+	case OP_CP2:
+		if (c.r.op == OP_CP2_BASIC && c.r.rs == OP_CP2_BASIC_MTC2)
+			return gte_write_mask(c.r.rd);
+		return 0;
+	case OP_LWC2:
+		return gte_write_mask(c.i.rt);
+	default:
+		return 0;
+	}
+}
+
+static bool opcode_may_leave_block(union code c)
+{
+	return has_delay_slot(c) || c.i.op == OP_CP0 ||
+		(c.i.op == OP_SPECIAL && (c.r.op == OP_SPECIAL_SYSCALL ||
+					  c.r.op == OP_SPECIAL_BREAK));
+}
+
+static int lightrec_remove_dead_mtc2(struct lightrec_state *state,
+				     struct block *block)
+{
+	struct opcode *list = block->opcode_list;
+	unsigned int i, j;
+	u32 mask;
+	union code c;
+
+	/* Every MTC2 has to be seen by cop2_notify */
+	if (state->ops.cop2_notify)
+		return 0;
+
+	for (i = 0; i < block->nb_ops; i++) {
+		c = list[i].c;
+
+		if (c.i.op != OP_CP2 || c.r.op != OP_CP2_BASIC ||
+		    c.r.rs != OP_CP2_BASIC_MTC2 || is_delay_slot(list, i))
+			continue;
+
+		/* Only handle MTC2 to plain registers */
+		mask = gte_write_mask(c.r.rd);
+		if (mask != BIT(c.r.rd))
+			continue;
+
+		/* Drop the MTC2 if the register is overwritten before anything
+		 * can read it, without leaving the block in between. */
+		for (j = i + 1; j < block->nb_ops; j++) {
+			c = list[j].c;
+
+			if (opcode_gte_reads(c) & mask)
+				break;
+
+			if (opcode_gte_writes(c) & mask) {
+				pr_debug("Removing dead MTC2 to GTE reg %u at "
+					 "offset 0x%x\n", list[i].r.rd, i << 2);
+				list[i].opcode = 0;
+				break;
+			}
+
+			if (opcode_may_leave_block(c))
+				break;
+		}
+	}
+
+	return 0;
+}
+
 static int lightrec_switch_delay_slots(struct lightrec_state *state, struct block *block)
 {
 	struct opcode *list, *next = &block->opcode_list[0];
@@ -1714,6 +1834,127 @@ static int lightrec_early_unload(struct lightrec_state *state, struct block *blo
 	return 0;
 }
 
+static bool lightrec_is_fifo_write(const struct lightrec_state *state,
+				   const struct constprop_data *v,
+				   const struct opcode *op)
+{
+	const struct lightrec_fifo *fifo = state->ops.fifo;
+
+	/* The FIFO emitter appends the raw register value to the buffer,
+	 * which is expected to hold little-endian words. */
+	return fifo && fifo->size && !is_big_endian()
+		&& op->i.op == OP_SW && is_known(v, op->i.rs)
+		&& kunseg(v[op->i.rs].value + (s16) op->i.imm) == fifo->kaddr;
+}
+
+/* Match the loop starting at the given LBU against the shape used to read
+ * a byte-wide FIFO by hand:
+ *
+ * 1:	lbu	rt, imm(rs)
+ *	... sb rt, off(ptr); addiu ptr, ptr, 1; [addiu cnt, cnt, +/-1]
+ *	bne	cnt, end, 1b		(or bne ptr, end, 1b)
+ *	...
+ *
+ * in any order after the LBU, with the SB after it and NOPs allowed. */
+bool lightrec_get_fifo_loop(const struct block *block, u16 offset,
+			    struct lightrec_fifo_loop *loop)
+{
+	const struct opcode *op, *list = block->opcode_list;
+	union code c, head = list[offset].c;
+	u64 stepped = 0, pre_branch = 0, pre_sb = 0;
+	s16 step[32];
+	u16 branch, i;
+	bool has_sb = false;
+	u8 rs, rt;
+
+	if (head.i.op != OP_LBU || !head.i.rt || head.i.rt == head.i.rs)
+		return false;
+
+	for (branch = offset + 1; branch < block->nb_ops; branch++) {
+		op = &list[branch];
+
+		if (branch - offset > 8 || op_flag_sync(op->flags))
+			return false;
+
+		if (has_delay_slot(op->c))
+			break;
+	}
+
+	if (branch >= block->nb_ops)
+		return false;
+
+	op = &list[branch];
+	if (op->i.op != OP_BNE || !op_flag_local_branch(op->flags)
+	    || branch + 1 - op_flag_no_ds(op->flags) + (s16)op->i.imm != offset)
+		return false;
+
+	loop->last = branch + !op_flag_no_ds(op->flags);
+	if (loop->last >= block->nb_ops)
+		return false;
+
+	for (i = offset + 1; i <= loop->last; i++) {
+		c = list[i].c;
+
+		if (i == branch) {
+			pre_branch = stepped;
+			continue;
+		}
+
+		if (!c.opcode)
+			continue;
+
+		switch (c.i.op) {
+		case OP_SB:
+			if (has_sb || c.i.rt != head.i.rt)
+				return false;
+
+			has_sb = true;
+			pre_sb = stepped;
+			loop->ptr = c.i.rs;
+			loop->dst_off = (s16)c.i.imm;
+			break;
+		case OP_ADDIU:
+			if (!c.i.rt || c.i.rs != c.i.rt || (stepped & BIT(c.i.rt))
+			    || ((s16)c.i.imm != 1 && (s16)c.i.imm != -1))
+				return false;
+
+			stepped |= BIT(c.i.rt);
+			step[c.i.rt] = (s16)c.i.imm;
+			break;
+		default:
+			return false;
+		}
+	}
+
+	if (!has_sb || !(stepped & BIT(loop->ptr)) || step[loop->ptr] != 1
+	    || (stepped & (BIT(head.i.rt) | BIT(head.i.rs))))
+		return false;
+
+	rs = op->i.rs;
+	rt = op->i.rt;
+
+	if ((stepped & BIT(rs)) && !(stepped & BIT(rt))) {
+		loop->cnt = rs;
+		loop->end = rt;
+	} else if ((stepped & BIT(rt)) && !(stepped & BIT(rs))) {
+		loop->cnt = rt;
+		loop->end = rs;
+	} else {
+		return false;
+	}
+
+	/* All stepped registers must be accounted for */
+	if (loop->end == head.i.rt
+	    || stepped != (BIT(loop->ptr) | BIT(loop->cnt)))
+		return false;
+
+	loop->cnt_step = step[loop->cnt];
+	loop->cnt_pre = !!(pre_branch & BIT(loop->cnt));
+	loop->dst_off += !!(pre_sb & BIT(loop->ptr));
+
+	return true;
+}
+
 static int lightrec_flag_io(struct lightrec_state *state, struct block *block)
 {
 	struct opcode *list;
@@ -1811,7 +2052,11 @@ static int lightrec_flag_io(struct lightrec_state *state, struct block *block)
 					list->flags |= LIGHTREC_NO_INVALIDATE;
 					break;
 				case PSX_MAP_HW_REGISTERS:
-					if (state->ops.hw_direct &&
+					if (lightrec_is_fifo_write(state, v, list)) {
+						pr_debug("Flagging opcode %u as FIFO write\n",
+							 i);
+						list->flags |= LIGHTREC_IO_MODE(LIGHTREC_IO_FIFO);
+					} else if (state->ops.hw_direct &&
 					    state->ops.hw_direct(kunseg_val,
 								 opcode_is_store(list->c),
 								 opcode_get_io_size(list->c))) {
@@ -1842,6 +2087,17 @@ static int lightrec_flag_io(struct lightrec_state *state, struct block *block)
 					list->flags |= LIGHTREC_IO_MODE(LIGHTREC_IO_RAM);
 				else
 					list->flags |= LIGHTREC_IO_MODE(LIGHTREC_IO_DIRECT);
+
+				/* Games that keep their stack or hot data in
+				 * the scratchpad do so for long stretches, so
+				 * trust the current value of the register. */
+				if (!(state->opt_flags & LIGHTREC_OPT_SP_GP_HIT_RAM)
+				    && lightrec_get_map(state, NULL,
+							kunseg(state->regs.gpr[list->i.rs]))
+				    == &state->maps[PSX_MAP_SCRATCH_PAD]) {
+					pr_debug("Opcode %u likely hits the scratchpad\n", i);
+					list->flags |= LIGHTREC_SCRATCH_HINT;
+				}
 			}
 
 			fallthrough;
@@ -2324,6 +2580,7 @@ static int (*lightrec_optimizers[])(struct lightrec_state *state, struct block *
 	IF_OPT(OPT_TRANSFORM_OPS, &lightrec_transform_branches),
 	IF_OPT(OPT_LOCAL_BRANCHES, &lightrec_local_branches),
 	IF_OPT(OPT_TRANSFORM_OPS, &lightrec_transform_ops),
+	IF_OPT(OPT_REMOVE_DEAD_MTC2, &lightrec_remove_dead_mtc2),
 	IF_OPT(OPT_SWITCH_DELAY_SLOTS, &lightrec_switch_delay_slots),
 	IF_OPT(OPT_FLAG_IO, &lightrec_flag_io),
 	IF_OPT(OPT_FLAG_MULT_DIV, &lightrec_flag_mults_divs),
@@ -11,6 +11,17 @@
 struct block;
 struct opcode;
 
+/* Byte copy loop reading from an I/O port, see lightrec_get_fifo_loop() */
+struct lightrec_fifo_loop {
+	u16 last;	/* offset of the last opcode of the loop */
+	u8 ptr;		/* destination pointer, incremented each iteration */
+	u8 cnt;		/* register tested by the branch; can be ptr */
+	u8 end;		/* loop-invariant register it is compared to */
+	s8 cnt_step;	/* +1 or -1 */
+	_Bool cnt_pre;	/* cnt is stepped before the branch tests it */
+	s16 dst_off;	/* destination of the first byte, relative to ptr */
+};
+
 __cnst _Bool opcode_reads_register(union code op, u8 reg);
 __cnst _Bool opcode_writes_register(union code op, u8 reg);
 __cnst u64 opcode_write_mask(union code op);
@@ -23,6 +34,9 @@ __cnst _Bool is_syscall(union code c);
 
 _Bool should_emulate(const struct opcode *op);
 
+_Bool lightrec_get_fifo_loop(const struct block *block, u16 offset,
+			     struct lightrec_fifo_loop *loop);
+
 int lightrec_optimize(struct lightrec_state *state, struct block *block);
 
 #endif /* __OPTIMIZER_H__ */
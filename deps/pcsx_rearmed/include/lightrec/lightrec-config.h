@@ -10,6 +10,7 @@
 #define ENABLE_FIRST_PASS 1
 #define ENABLE_DISASSEMBLER 0
 #define ENABLE_CODE_BUFFER 1
+#define ENABLE_STATS 0
 
 #define HAS_DEFAULT_ELM 1
 
@@ -18,6 +19,7 @@
 #define OPT_DETECT_IMPOSSIBLE_BRANCHES 1
 #define OPT_HANDLE_LOAD_DELAYS 1
 #define OPT_TRANSFORM_OPS 1
+#define OPT_REMOVE_DEAD_MTC2 1
 #define OPT_LOCAL_BRANCHES 1
 #define OPT_SWITCH_DELAY_SLOTS 1
 #define OPT_FLAG_IO 1
@@ -1555,6 +1555,22 @@ unsigned char cdrRead2(void) {
 	return ret;
 }
 
+// same as 'size' cdrRead2() calls, for PIO loops run in bulk by the dynarec
+unsigned int cdrReadFifo(unsigned char *dst, unsigned int size) {
+	unsigned int left = 0;
+
+	if (cdr.FifoOffset < cdr.FifoSize)
+		left = cdr.FifoSize - cdr.FifoOffset;
+	if (size > left)
+		size = left;
+
+	memcpy(dst, cdr.Transfer + cdr.FifoOffset, size);
+	cdr.FifoOffset += size;
+
+	CDR_LOG_IO("cdr r2.x.dat: %u bytes\n", size);
+	return size;
+}
+
 void cdrWrite2(unsigned char rt) {
 	const char *rnames[] = { "0.prm", "1.ien", "2.all", "3.arl" }; (void)rnames;
 	CDR_LOG_IO("cdr w2.%s: %02x\n", rnames[cdr.Ctrl & 3], rt);
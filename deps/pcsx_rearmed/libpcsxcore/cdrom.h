@@ -56,6 +56,7 @@ unsigned char cdrRead0(void);
 unsigned char cdrRead1(void);
 unsigned char cdrRead2(void);
 unsigned char cdrRead3(void);
+unsigned int cdrReadFifo(unsigned char *dst, unsigned int size);
 void cdrWrite0(unsigned char rt);
 void cdrWrite1(unsigned char rt);
 void cdrWrite2(unsigned char rt);
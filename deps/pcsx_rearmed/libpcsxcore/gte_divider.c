@@ -33,17 +33,79 @@ static const u8 table[] =
 	0x00
 };
 
+#ifdef __sh__
+/*
+ * The SH4 has no count-leading-zeros instruction, so __builtin_clz() ends up
+ * as a libgcc call, and the 64-bit add and shift of the final product are
+ * split into several instructions. Normalize the denominator with a byte
+ * lookup instead, and do the final multiply with dmulu.l, rounding with
+ * addc and taking bits 16..47 of the product with xtrct.
+ */
+static const u8 clz8[256] =
+{
+	8, 7, 6, 6, 5, 5, 5, 5, 4, 4, 4, 4, 4, 4, 4, 4,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static inline int gte_clz16(u16 x)
+{
+	return x & 0xff00 ? clz8[x >> 8] : 8 + clz8[x];
+}
+
+static inline u32 gte_mul_round16(u32 a, u32 b)
+{
+	u32 hi, lo, round = 0x8000, zero = 0;
+
+	__asm__("dmulu.l	%2, %3\n\t"
+		"sts	mach, %0\n\t"
+		"sts	macl, %1\n\t"
+		"clrt\n\t"
+		"addc	%4, %1\n\t"
+		"addc	%5, %0\n\t"
+		"xtrct	%0, %1"
+		: "=&r"(hi), "=&r"(lo)
+		: "r"(a), "r"(b), "r"(round), "r"(zero)
+		: "mach", "macl", "t");
+
+	return lo;
+}
+#else
+static inline int gte_clz16(u16 x)
+{
+	return __builtin_clz(x) - 16;
+}
+
+static inline u32 gte_mul_round16(u32 a, u32 b)
+{
+	return ((u64)a * b + 0x8000) >> 16;
+}
+#endif
+
 u32 DIVIDE(u16 numerator, u16 denominator)
 {
 	if (numerator < (denominator * 2)) {
-		int shift = __builtin_clz(denominator) - 16;
+		int shift = gte_clz16(denominator);
 
 		int r1 = (denominator << shift) & 0x7fff;
 		int r2 = table[(r1 + 0x40) >> 7] + 0x101;
 		int r3 = ((0x80 - r2 * (r1 + 0x8000)) >> 8) & 0x1ffff;
 		u32 reciprocal = (r2 * r3 + 0x80) >> 8;
 
-		return ((u64)reciprocal * (numerator << shift) + 0x8000) >> 16;
+		return gte_mul_round16(reciprocal, numerator << shift);
 	}
 
 	return 0xffffffff;
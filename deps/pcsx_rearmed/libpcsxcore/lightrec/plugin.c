@@ -72,9 +72,51 @@ static bool use_lightrec_interpreter;
 static bool use_pcsx_interpreter;
 static bool block_stepping;
 
+#ifdef EMU_STATS
+/* Number of times the dynarec returned to the emulator */
+static unsigned int lightrec_nb_exits;
+
+/* Number of times events were serviced without leaving the dynarec */
+static unsigned int lightrec_nb_event_services;
+
+/* Number of CD-ROM data port reads done in bulk for PIO loops */
+static unsigned int lightrec_nb_fifo_reads;
+
+void lightrec_plugin_print_stats(unsigned int frames, unsigned int ms)
+{
+	static unsigned int last_int_ops;
+	unsigned int int_ops;
+
+	printf("Dynarec exits: %u (%u/frame), %u events serviced in place\n",
+	       lightrec_nb_exits, frames ? lightrec_nb_exits / frames : 0,
+	       lightrec_nb_event_services);
+	printf("CD-ROM: %u PIO reads done in bulk\n", lightrec_nb_fifo_reads);
+
+	lightrec_nb_exits = 0;
+	lightrec_nb_event_services = 0;
+	lightrec_nb_fifo_reads = 0;
+
+	/* Only counted when Lightrec is built with ENABLE_STATS. The count
+	 * only restarts with a new state, so print the difference since the
+	 * last call. */
+	if (lightrec_state && ms) {
+		int_ops = lightrec_int_op_count(lightrec_state);
+		if (int_ops < last_int_ops)
+			last_int_ops = 0;
+
+		printf("Interpreter: %u opcodes, %llu/s\n",
+		       int_ops - last_int_ops,
+		       (unsigned long long)(int_ops - last_int_ops) * 1000 / ms);
+
+		last_int_ops = int_ops;
+	}
+}
+#endif
+
 extern u32 lightrec_hacks;
 
 extern void lightrec_code_inv(void *ptr, uint32_t len);
+extern void lightrec_code_inv_all(void);
 
 enum my_cp2_opcodes {
 	OP_CP2_RTPS		= 0x01,
@@ -241,6 +283,24 @@ static u32 hw_read_word(struct lightrec_state *state,
 	return val;
 }
 
+static void service_events(struct lightrec_state *state)
+{
+	struct lightrec_registers *regs = lightrec_get_registers(state);
+
+	lightrec_tansition_to_pcsx(state);
+
+	/* Interrupts, and stop requests, go through the main loop; anything
+	 * else can be handled without unwinding */
+	if (events_service((psxCP0Regs *)regs->cp0) || stop)
+		lightrec_set_exit_flags(state, LIGHTREC_EXIT_CHECK_INTERRUPT);
+#ifdef EMU_STATS
+	else
+		lightrec_nb_event_services++;
+#endif
+
+	lightrec_tansition_from_pcsx(state);
+}
+
 static struct lightrec_mem_map_ops hw_regs_ops = {
 	.sb = hw_write_byte,
 	.sh = hw_write_half,
@@ -360,6 +420,7 @@ static bool lightrec_can_hw_direct(u32 kaddr, bool is_write, u8 size)
 		case 0x1f801801:
 		case 0x1f801802:
 		case 0x1f801803:
+		case 0x1f801070: // may have a lazy SIO IRQ to raise
 			return false;
 		default:
 			return true;
@@ -384,8 +445,8 @@ static bool lightrec_can_hw_direct(u32 kaddr, bool is_write, u8 size)
 		case 0x1f801120:
 		case 0x1f801124:
 		case 0x1f801128:
-			return false;
 		case 0x1f801070:
+			return false;
 		case 0x1f801074:
 			return !is_write;
 		default:
@@ -408,8 +469,8 @@ static bool lightrec_can_hw_direct(u32 kaddr, bool is_write, u8 size)
 		case 0x1f801814:
 		case 0x1f801820:
 		case 0x1f801824:
-			return false;
 		case 0x1f801070:
+			return false;
 		case 0x1f801074:
 		case 0x1f801088:
 		case 0x1f801098:
@@ -425,11 +486,34 @@ static bool lightrec_can_hw_direct(u32 kaddr, bool is_write, u8 size)
 	}
 }
 
+static struct lightrec_fifo gp0_fifo = {
+	.kaddr = 0x1f801810,
+};
+
+static u32 cdrom_fifo_read(struct lightrec_state *state, u8 *dst, u32 len)
+{
+	len = cdrReadFifo(dst, len);
+#ifdef EMU_STATS
+	lightrec_nb_fifo_reads += len;
+#endif
+
+	return len;
+}
+
+static const struct lightrec_read_fifo cdrom_fifo = {
+	.kaddr = 0x1f801802,
+	.read = cdrom_fifo_read,
+};
+
 static const struct lightrec_ops lightrec_ops = {
 	.cop2_op = cop2_op,
 	.enable_ram = lightrec_enable_ram,
 	.hw_direct = lightrec_can_hw_direct,
 	.code_inv = LIGHTREC_CODE_INV ? lightrec_code_inv : NULL,
+	.code_inv_all = LIGHTREC_CODE_INV ? lightrec_code_inv_all : NULL,
+	.fifo = &gp0_fifo,
+	.read_fifo = &cdrom_fifo,
+	.service_events = service_events,
 };
 
 static int lightrec_plugin_init(void)
@@ -512,6 +596,9 @@ static void lightrec_plugin_execute_internal(bool block_only)
 		} else {
 			psxRegs.pc = lightrec_execute(lightrec_state,
 						      psxRegs.pc, cycles_lightrec);
+#ifdef EMU_STATS
+			lightrec_nb_exits++;
+#endif
 		}
 
 		lightrec_tansition_to_pcsx(lightrec_state);
@@ -624,6 +711,15 @@ static void lightrec_plugin_reset(void)
 
 	regs = lightrec_get_registers(lightrec_state);
 
+	/* Let the compiled code append GP0 writes to the GPU's command buffer
+	 * directly, if the GPU plugin allows it */
+	if (GPU_getCmdBuffer) {
+		gp0_fifo.size = GPU_getCmdBuffer(&gp0_fifo.buffer,
+						 &gp0_fifo.len);
+	} else {
+		gp0_fifo.size = 0;
+	}
+
 	/* Invalidate all blocks */
 	lightrec_invalidate_all(lightrec_state);
 
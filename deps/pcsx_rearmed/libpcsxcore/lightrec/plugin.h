@@ -10,6 +10,10 @@
 
 #define drc_is_lightrec() 1
 
+#ifdef EMU_STATS
+void lightrec_plugin_print_stats(unsigned int frames, unsigned int ms);
+#endif
+
 #else /* if !LIGHTREC */
 
 #define drc_is_lightrec() 0
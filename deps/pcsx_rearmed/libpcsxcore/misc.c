@@ -699,6 +699,9 @@ int SaveState(const char *file) {
 
 	psxCpu->Notify(R3000ACPU_NOTIFY_BEFORE_SAVE, NULL);
 
+	// lazy SIO IRQs aren't part of the savestate format
+	sioFlushIrq();
+
 	SaveFuncs.write(f, (void *)PcsxHeader, 32);
 	SaveFuncs.write(f, (void *)&SaveVersion, sizeof(u32));
 	SaveFuncs.write(f, (void *)&Config.HLE, sizeof(boolean));
@@ -48,6 +48,7 @@ GPUgetScreenPic       GPU_getScreenPic;
 GPUshowScreenPic      GPU_showScreenPic;
 GPUvBlank             GPU_vBlank;
 GPUgetScreenInfo      GPU_getScreenInfo;
+GPUgetCmdBuffer       GPU_getCmdBuffer;
 
 CDRinit               CDR_init;
 CDRshutdown           CDR_shutdown;
@@ -235,6 +236,7 @@ static int LoadGPUplugin(const char *GPUdll) {
 	LoadGpuSym0(showScreenPic, "GPUshowScreenPic");
 	LoadGpuSym0(vBlank, "GPUvBlank");
 	LoadGpuSym0(getScreenInfo, "GPUgetScreenInfo");
+	LoadGpuSymN(getCmdBuffer, "GPUgetCmdBuffer");
 
 	return 0;
 }
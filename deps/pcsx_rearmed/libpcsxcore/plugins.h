@@ -74,6 +74,7 @@ typedef long (CALLBACK* GPUgetScreenPic)(unsigned char *);
 typedef long (CALLBACK* GPUshowScreenPic)(unsigned char *);
 typedef void (CALLBACK* GPUvBlank)(int, int);
 typedef void (CALLBACK* GPUgetScreenInfo)(int *, int *);
+typedef int (CALLBACK* GPUgetCmdBuffer)(uint32_t **, int **);
 
 // GPU function pointers
 extern GPUupdateLace    GPU_updateLace;
@@ -96,6 +97,7 @@ extern GPUgetScreenPic  GPU_getScreenPic;
 extern GPUshowScreenPic GPU_showScreenPic;
 extern GPUvBlank        GPU_vBlank;
 extern GPUgetScreenInfo GPU_getScreenInfo;
+extern GPUgetCmdBuffer  GPU_getCmdBuffer;
 
 // CD-ROM Functions
 typedef long (CALLBACK* CDRinit)(void);
@@ -54,8 +54,9 @@ static irq_func * const irq_funcs[] = {
 	[PSXINT_RCNT] = psxRcntUpdate,
 };
 
-/* local dupe of psxBranchTest, using event_cycles */
-void irq_test(psxCP0Regs *cp0)
+/* Run the events that are due and update the pending interrupt bit.
+ * Returns nonzero if the interrupt exception must be taken. */
+static int irq_update(psxCP0Regs *cp0)
 {
 	u32 cycle = psxRegs.cycle;
 	u32 irq, irq_bits;
@@ -73,7 +74,14 @@ void irq_test(psxCP0Regs *cp0)
 	cp0->n.Cause &= ~0x400;
 	if (psxHu32(0x1070) & psxHu32(0x1074))
 		cp0->n.Cause |= 0x400;
-	if (((cp0->n.Cause | 1) & cp0->n.SR & 0x401) == 0x401) {
+
+	return ((cp0->n.Cause | 1) & cp0->n.SR & 0x401) == 0x401;
+}
+
+/* local dupe of psxBranchTest, using event_cycles */
+void irq_test(psxCP0Regs *cp0)
+{
+	if (irq_update(cp0)) {
 		psxException(0, 0, cp0);
 		pending_exception = 1;
 	}
@@ -93,6 +101,18 @@ void gen_interupt(psxCP0Regs *cp0)
 		next_interupt, next_interupt - psxRegs.cycle);
 }
 
+/* Same as gen_interupt(), for callers that can't change the PC: the
+ * interrupt exception is left for the next gen_interupt() to take.
+ * Returns nonzero if one is pending. */
+int events_service(psxCP0Regs *cp0)
+{
+	int irq = irq_update(cp0);
+
+	schedule_timeslice();
+
+	return irq;
+}
+
 void events_restore(void)
 {
 	int i;
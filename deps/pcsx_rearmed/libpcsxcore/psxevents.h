@@ -47,6 +47,7 @@ union psxCP0Regs_;
 u32  schedule_timeslice(void);
 void irq_test(union psxCP0Regs_ *cp0);
 void gen_interupt(union psxCP0Regs_ *cp0);
+int  events_service(union psxCP0Regs_ *cp0);
 void events_restore(void);
 
 #endif // __PSXEVENTS_H__
@@ -38,7 +38,11 @@ void psxHwReset() {
 
 void psxHwWriteIstat(u32 value)
 {
-	u32 stat = psxHu16(0x1070) & value;
+	u32 stat;
+
+	sioSyncIrq();
+
+	stat = psxHu16(0x1070) & value;
 	psxHu16ref(0x1070) = SWAPu16(stat);
 
 	psxRegs.CP0.n.Cause &= ~0x400;
@@ -48,7 +52,13 @@ void psxHwWriteIstat(u32 value)
 
 void psxHwWriteImask(u32 value)
 {
-	u32 stat = psxHu16(0x1070);
+	u32 stat;
+
+	sioSyncIrq();
+	if (value & 0x80)
+		sioFlushIrq();
+
+	stat = psxHu16(0x1070);
 	psxHu16ref(0x1074) = SWAPu16(value);
 	if (stat & value) {
 		//if ((psxRegs.CP0.n.SR & 0x401) == 0x401)
@@ -137,6 +147,7 @@ u8 psxHwRead8(u32 add) {
 
 	switch (add & 0xffff) {
 	case 0x1040: hard = sioRead8(); break;
+	case 0x1070: sioSyncIrq(); hard = psxHu8(add); break;
 	case 0x1800: hard = cdrRead0(); break;
 	case 0x1801: hard = cdrRead1(); break;
 	case 0x1802: hard = cdrRead2(); break;
@@ -196,6 +207,7 @@ u16 psxHwRead16(u32 add) {
 	case 0x104a: hard = sioReadCtrl16(); break;
 	case 0x104e: hard = sioReadBaud16(); break;
 	case 0x1054: hard = sio1ReadStat16(); break;
+	case 0x1070: sioSyncIrq(); hard = psxHu16(add); break;
 	case 0x1100: hard = psxRcntRcount0(); break;
 	case 0x1104: hard = psxRcntRmode(0); break;
 	case 0x1108: hard = psxRcntRtarget(0); break;
@@ -243,6 +255,7 @@ u32 psxHwRead32(u32 add) {
 	switch (add & 0xffff) {
 	case 0x1040: hard = sioRead8(); break;
 	case 0x1044: hard = sioReadStat16(); break;
+	case 0x1070: sioSyncIrq(); hard = psxHu32(add); break;
 	case 0x1100: hard = psxRcntRcount0(); break;
 	case 0x1104: hard = psxRcntRmode(0); break;
 	case 0x1108: hard = psxRcntRtarget(0); break;
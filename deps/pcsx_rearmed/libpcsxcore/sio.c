@@ -79,6 +79,61 @@ char McdDisable[2];
 // TODO: add SioModePrescaler and BaudReg
 #define SIO_CYCLES		535
 
+// When IRQ7 is masked in I_MASK, the CPU can't take the SIO interrupt and
+// can only see it by polling I_STAT or SIO_STAT (which the BIOS pad/card
+// code does). Don't schedule an event (and force a dynarec exit) per byte
+// in that case; raise the IRQ lazily when one of those is read instead.
+static u32 lazy_irq_cycle;
+static int lazy_irq;
+
+#ifdef EMU_STATS
+static unsigned int sio_nb_events, sio_nb_lazy_irqs;
+
+void sioPrintStats(void) {
+	printf("SIO: %u events, %u lazy IRQs\n", sio_nb_events, sio_nb_lazy_irqs);
+
+	sio_nb_events = sio_nb_lazy_irqs = 0;
+}
+#endif
+
+static void sioScheduleIrq(void) {
+	if (psxHu16(0x1074) & 0x80) {
+#ifdef EMU_STATS
+		sio_nb_events++;
+#endif
+		set_event(PSXINT_SIO, SIO_CYCLES);
+	} else {
+#ifdef EMU_STATS
+		sio_nb_lazy_irqs++;
+#endif
+		lazy_irq = 1;
+		lazy_irq_cycle = psxRegs.cycle + SIO_CYCLES;
+	}
+}
+
+// Raise the pending SIO IRQ if it is due
+void sioSyncIrq(void) {
+	if (lazy_irq && (s32)(psxRegs.cycle - lazy_irq_cycle) >= 0) {
+		lazy_irq = 0;
+		sioInterrupt();
+	}
+}
+
+// Turn the pending SIO IRQ into a regular event, when it may now be taken
+// by the CPU or before a savestate
+void sioFlushIrq(void) {
+	s32 left = lazy_irq_cycle - psxRegs.cycle;
+
+	if (!lazy_irq)
+		return;
+
+	lazy_irq = 0;
+	if (left > 0)
+		set_event(PSXINT_SIO, left);
+	else
+		sioInterrupt();
+}
+
 void sioWrite8(unsigned char value) {
 	int more_data = 0;
 #if 0
@@ -101,7 +156,7 @@ void sioWrite8(unsigned char value) {
 
 				if (more_data) {
 					bufcount = parp + 1;
-					set_event(PSXINT_SIO, SIO_CYCLES);
+					sioScheduleIrq();
 				}
 			}
 			else padst = 0;
@@ -115,14 +170,14 @@ void sioWrite8(unsigned char value) {
 
 			if (more_data) {
 				bufcount = parp + 1;
-				set_event(PSXINT_SIO, SIO_CYCLES);
+				sioScheduleIrq();
 			}
 			return;
 	}
 
 	switch (mcdst) {
 		case 1:
-			set_event(PSXINT_SIO, SIO_CYCLES);
+			sioScheduleIrq();
 			if (rdwr) { parp++; return; }
 			parp = 1;
 			switch (value) {
@@ -132,7 +187,7 @@ void sioWrite8(unsigned char value) {
 			}
 			return;
 		case 2: // address H
-			set_event(PSXINT_SIO, SIO_CYCLES);
+			sioScheduleIrq();
 			adrH = value;
 			*buf = 0;
 			parp = 0;
@@ -140,7 +195,7 @@ void sioWrite8(unsigned char value) {
 			mcdst = 3;
 			return;
 		case 3: // address L
-			set_event(PSXINT_SIO, SIO_CYCLES);
+			sioScheduleIrq();
 			adrL = value;
 			*buf = adrH;
 			parp = 0;
@@ -148,7 +203,7 @@ void sioWrite8(unsigned char value) {
 			mcdst = 4;
 			return;
 		case 4:
-			set_event(PSXINT_SIO, SIO_CYCLES);
+			sioScheduleIrq();
 			parp = 0;
 			switch (rdwr) {
 				case 1: // read
@@ -198,7 +253,7 @@ void sioWrite8(unsigned char value) {
 			if (rdwr == 2) {
 				if (parp < 128) buf[parp + 1] = value;
 			}
-			set_event(PSXINT_SIO, SIO_CYCLES);
+			sioScheduleIrq();
 			return;
 	}
 
@@ -213,7 +268,7 @@ void sioWrite8(unsigned char value) {
 			bufcount = 1;
 			parp = 0;
 			padst = 1;
-			set_event(PSXINT_SIO, SIO_CYCLES);
+			sioScheduleIrq();
 			return;
 		case 0x81: // start memcard
 			if (CtrlReg & 0x2000)
@@ -233,7 +288,7 @@ void sioWrite8(unsigned char value) {
 			bufcount = 3;
 			mcdst = 1;
 			rdwr = 0;
-			set_event(PSXINT_SIO, SIO_CYCLES);
+			sioScheduleIrq();
 			return;
 		default:
 		no_device:
@@ -259,6 +314,7 @@ void sioWriteCtrl16(unsigned short value) {
 		padst = 0; mcdst = 0; parp = 0;
 		StatReg = TX_RDY | TX_EMPTY;
 		psxRegs.interrupt &= ~(1 << PSXINT_SIO);
+		lazy_irq = 0;
 	}
 }
 
@@ -306,6 +362,7 @@ unsigned char sioRead8() {
 }
 
 unsigned short sioReadStat16() {
+	sioSyncIrq();
 	return StatReg;
 }
 
@@ -784,5 +841,8 @@ int sioFreeze(void *f, int Mode) {
 	gzfreeze(&adrL, sizeof(adrL));
 	gzfreeze(&padst, sizeof(padst));
 
+	if (Mode == 0)
+		lazy_irq = 0;
+
 	return 0;
 }
@@ -49,6 +49,11 @@ unsigned short sioReadCtrl16();
 unsigned short sioReadBaud16();
 
 void sioInterrupt();
+void sioSyncIrq(void);
+void sioFlushIrq(void);
+#ifdef EMU_STATS
+void sioPrintStats(void);
+#endif
 int sioFreeze(void *f, int Mode);
 
 void LoadMcd(int mcd, char *str);
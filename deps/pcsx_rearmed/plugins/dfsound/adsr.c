@@ -63,10 +63,79 @@ INLINE void StartADSR(int ch)                          // MIX ADSR
 
 ////////////////////////////////////////////////////////////////////////
 
+// number of samples, up to n, a linear segment can run before the
+// envelope leaves [lo, hi]
+static int LinearADSRLen(unsigned int EnvelopeVol, int val,
+                         unsigned int lo, unsigned int hi, int n)
+{
+ unsigned int room;
+
+ if ((signed int)EnvelopeVol < 0)
+  return 0;
+ if (val > 0)
+  room = EnvelopeVol <= hi ? (hi - EnvelopeVol) / val : 0;
+ else if (val < 0)
+  room = EnvelopeVol >= lo ? (EnvelopeVol - lo) / -val : 0;
+ else // a flat segment only lasts if it starts within the range
+  room = EnvelopeVol >= lo && EnvelopeVol <= hi ? (unsigned int)n : 0;
+
+ return room < (unsigned int)n ? (int)room : n;
+}
+
+// scale the samples by a linear segment of n samples. The volume only
+// moves by one step every 2^21 / |val| samples, so slow segments are
+// done in runs of constant volume, and silent runs are just cleared.
+static void LinearADSR(int *samples, unsigned int EnvelopeVol, int val, int n)
+{
+ unsigned int run;
+ int i, vol;
+
+ if (val >= (1 << 17) || val <= -(1 << 17))
+ {
+   for (i = 0; i < n; i++)
+   {
+     EnvelopeVol += val;
+     samples[i] *= (signed int)EnvelopeVol >> 21;
+     samples[i] >>= 10;
+   }
+   return;
+ }
+
+ while (n > 0)
+ {
+   EnvelopeVol += val;
+   vol = (signed int)EnvelopeVol >> 21;
+
+   if (val > 0)
+     run = ((((unsigned int)vol + 1) << 21) - 1 - EnvelopeVol) / val + 1;
+   else if (val < 0)
+     run = (EnvelopeVol - ((unsigned int)vol << 21)) / -val + 1;
+   else
+     run = n;
+   if (run > (unsigned int)n)
+     run = n;
+
+   if (vol == 0)
+     memset(samples, 0, run * sizeof(samples[0]));
+   else
+   {
+     for (i = 0; i < (int)run; i++)
+     {
+       samples[i] *= vol;
+       samples[i] >>= 10;
+     }
+   }
+
+   EnvelopeVol += val * (run - 1);
+   samples += run;
+   n -= run;
+ }
+}
+
 static int MixADSR(int *samples, ADSRInfoEx *adsr, int ns_to)
 {
  unsigned int EnvelopeVol = adsr->EnvelopeVol;
- int ns = 0, val, rto, level;
+ int ns = 0, val, rto, level, len;
 
  if (adsr->State == ADSR_RELEASE)
  {
@@ -86,15 +155,11 @@ static int MixADSR(int *samples, ADSRInfoEx *adsr, int ns_to)
    }
    else
    {
-     for (; ns < ns_to; ns++)
-     {
+     ns = LinearADSRLen(EnvelopeVol, val, 1, 0x7fffffff, ns_to);
+     LinearADSR(samples, EnvelopeVol, val, ns);
+     EnvelopeVol += val * ns;
+     if (ns < ns_to)
        EnvelopeVol += val;
-       if ((signed int)EnvelopeVol <= 0)
-         break;
-
-       samples[ns] *= (signed int)EnvelopeVol >> 21;
-       samples[ns] >>= 10;
-     }
    }
 
    goto done;
@@ -108,17 +173,11 @@ static int MixADSR(int *samples, ADSRInfoEx *adsr, int ns_to)
        rto = 8;
      val = RateTableAdd[adsr->AttackRate + rto];
 
-     for (; ns < ns_to; ns++)
-     {
-       EnvelopeVol += val;
-       if ((signed int)EnvelopeVol < 0) // overflow
-        break;
+     ns = LinearADSRLen(EnvelopeVol, val, 0, 0x7fffffff, ns_to);
+     LinearADSR(samples, EnvelopeVol, val, ns);
+     EnvelopeVol += val * ns;
 
-       samples[ns] *= (signed int)EnvelopeVol >> 21;
-       samples[ns] >>= 10;
-     }
-
-     if ((signed int)EnvelopeVol < 0) // overflow
+     if (ns < ns_to) // overflow
      {
        EnvelopeVol = 0x7fffffff;
        adsr->State = ADSR_DECAY;
@@ -167,18 +226,14 @@ static int MixADSR(int *samples, ADSRInfoEx *adsr, int ns_to)
          rto = 8;
        val = RateTableAdd[adsr->SustainRate + rto];
 
-       for (; ns < ns_to; ns++)
+       len = LinearADSRLen(EnvelopeVol, val, 0, 0x7fdfffff, ns_to - ns);
+       LinearADSR(samples + ns, EnvelopeVol, val, len);
+       EnvelopeVol += val * len;
+       ns += len;
+       if (ns < ns_to)
        {
-         EnvelopeVol += val;
-         if (EnvelopeVol >= 0x7fe00000)
-         {
-           EnvelopeVol = 0x7fffffff;
-           ns = ns_to;
-           break;
-         }
-
-         samples[ns] *= (signed int)EnvelopeVol >> 21;
-         samples[ns] >>= 10;
+         EnvelopeVol = 0x7fffffff;
+         ns = ns_to;
        }
      }
      else
@@ -198,15 +253,12 @@ static int MixADSR(int *samples, ADSRInfoEx *adsr, int ns_to)
        }
        else
        {
-         for (; ns < ns_to; ns++)
-         {
+         len = LinearADSRLen(EnvelopeVol, val, 0, 0x7fffffff, ns_to - ns);
+         LinearADSR(samples + ns, EnvelopeVol, val, len);
+         EnvelopeVol += val * len;
+         ns += len;
+         if (ns < ns_to)
            EnvelopeVol += val;
-           if ((signed int)EnvelopeVol < 0)
-             break;
-
-           samples[ns] *= (signed int)EnvelopeVol >> 21;
-           samples[ns] >>= 10;
-         }
        }
      }
      break;
@@ -254,13 +306,9 @@ static int SkipADSR(ADSRInfoEx *adsr, int ns_to)
        rto = 8;
      val = RateTableAdd[adsr->AttackRate + rto];
 
-     for (; ns < ns_to; ns++)
-     {
-       EnvelopeVol += val;
-       if ((signed int)EnvelopeVol < 0)
-        break;
-     }
-     if ((signed int)EnvelopeVol < 0) // overflow
+     ns = LinearADSRLen(EnvelopeVol, val, 0, 0x7fffffff, ns_to);
+     EnvelopeVol += val * ns;
+     if (ns < ns_to) // overflow
      {
        EnvelopeVol = 0x7fffffff;
        adsr->State = ADSR_DECAY;
@@ -71,6 +71,7 @@ void CALLBACK SPUwriteDMAMem(unsigned short *pusPSXMem, int iSize,
  do_samples_if_needed(cycles + iSize*2 * 4, 1, 2);
  irq_after = (irq_addr - addr) & 0x7ffff;
  spu.bMemDirty = 1;
+ adpcm_cache_invalidate(addr, iSize*2);
 
  if (addr + iSize*2 < 0x80000)
  {
@@ -288,6 +288,7 @@ void do_irq_io(int cycles_after);
 #endif
 
 void FeedXA(const xa_decode_t *xap);
+void adpcm_cache_invalidate(unsigned int addr, unsigned int len);
 void FeedCDDA(unsigned char *pcm, int nBytes);
 
 #endif /* __P_SOUND_EXTERNALS_H__ */
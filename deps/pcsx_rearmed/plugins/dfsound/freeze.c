@@ -329,6 +329,7 @@ long CALLBACK SPUfreeze(unsigned int ulFreezeMode, SPUFreeze_t * pF,
  memcpy(spu.spuMem,pF->cSPURam,0x80000);               // get ram
  memcpy(spu.regArea,pF->cSPUPort,0x200);
  spu.bMemDirty = 1;
+ adpcm_cache_invalidate(0, 0x80000);
  spu.spuCtrl = regAreaGet(H_SPUctrl);
  spu.spuStat = regAreaGet(H_SPUstat);
 
@@ -138,6 +138,7 @@ void CALLBACK SPUwriteRegister(unsigned long reg, unsigned short val,
     //-------------------------------------------------//
     case H_SPUdata:
       *(unsigned short *)(spu.spuMemC + spu.spuAddr) = HTOLE16(val);
+      adpcm_cache_invalidate(spu.spuAddr, 2);
       spu.spuAddr += 2;
       spu.spuAddr &= 0x7fffe;
       check_irq_io(spu.spuAddr);
@@ -49,18 +49,45 @@ INLINE int rvb2ram_offs(int curr, int space, int iOff)
  return iOff;
 }
 
-// get_buffer content helper: takes care about wraps
-#define g_buffer(var) \
- ((int)(signed short)LE16TOH(spu.spuMem[rvb2ram_offs(curr_addr, space, rvb->var)]))
+// Reverb buffer taps. Within a run returned by rvb_setup_taps() none of
+// them wraps, so the mixers can index them linearly.
+enum {
+ TAP_IIR_SRC_A0, TAP_IIR_SRC_A1, TAP_IIR_SRC_B0, TAP_IIR_SRC_B1,
+ TAP_IIR_DEST_A0, TAP_IIR_DEST_A1, TAP_IIR_DEST_B0, TAP_IIR_DEST_B1,
+ TAP_IIR_NEXT_A0, TAP_IIR_NEXT_A1, TAP_IIR_NEXT_B0, TAP_IIR_NEXT_B1,
+ TAP_ACC_SRC_A0, TAP_ACC_SRC_B0, TAP_ACC_SRC_C0, TAP_ACC_SRC_D0,
+ TAP_ACC_SRC_A1, TAP_ACC_SRC_B1, TAP_ACC_SRC_C1, TAP_ACC_SRC_D1,
+ TAP_FB_SRC_A0, TAP_FB_SRC_A1, TAP_FB_SRC_B0, TAP_FB_SRC_B1,
+ TAP_MIX_DEST_A0, TAP_MIX_DEST_A1, TAP_MIX_DEST_B0, TAP_MIX_DEST_B1,
+ TAP_COUNT
+};
+
+// point each tap at spu ram for curr_addr and return for how many
+// samples (at most 'left') all of them advance without wrapping
+static int rvb_setup_taps(unsigned short **tap, const int *offs, int count,
+                          int curr_addr, int space, int left)
+{
+ int i, a, len = 0x40000 - curr_addr;
 
-// saturate iVal and store it as var
-#define s_buffer(var, iVal) \
- ssat32_to_16(iVal); \
- spu.spuMem[rvb2ram_offs(curr_addr, space, rvb->var)] = HTOLE16(iVal)
+ if (len > left) len = left;
+
+ for (i = 0; i < count; i++)
+  {
+   a = rvb2ram_offs(curr_addr, space, offs[i]);
+   if (0x40000 - a < len) len = 0x40000 - a;
+   tap[i] = spu.spuMem + a;
+  }
+ return len;
+}
+
+// get_buffer content helper, i is the sample within the run
+#define g_buffer(t) \
+ ((int)(signed short)LE16TOH(tap[TAP_##t][i]))
 
-#define s_buffer1(var, iVal) \
+// saturate iVal and store it as tap t
+#define s_buffer(t, iVal) \
  ssat32_to_16(iVal); \
- spu.spuMem[rvb2ram_offs(curr_addr, space, rvb->var + 1)] = HTOLE16(iVal)
+ tap[TAP_##t][i] = HTOLE16(iVal)
 
 ////////////////////////////////////////////////////////////////////////
 
@@ -68,80 +95,98 @@ INLINE int rvb2ram_offs(int curr, int space, int iOff)
 static void MixREVERB(int *SSumLR, int *RVB, int ns_to, int curr_addr)
 {
  const REVERBInfo *rvb = spu.rvb;
+ const int offs[TAP_COUNT] = {
+  rvb->IIR_SRC_A0, rvb->IIR_SRC_A1, rvb->IIR_SRC_B0, rvb->IIR_SRC_B1,
+  rvb->IIR_DEST_A0, rvb->IIR_DEST_A1, rvb->IIR_DEST_B0, rvb->IIR_DEST_B1,
+  rvb->IIR_DEST_A0 + 1, rvb->IIR_DEST_A1 + 1,
+  rvb->IIR_DEST_B0 + 1, rvb->IIR_DEST_B1 + 1,
+  rvb->ACC_SRC_A0, rvb->ACC_SRC_B0, rvb->ACC_SRC_C0, rvb->ACC_SRC_D0,
+  rvb->ACC_SRC_A1, rvb->ACC_SRC_B1, rvb->ACC_SRC_C1, rvb->ACC_SRC_D1,
+  rvb->FB_SRC_A0, rvb->FB_SRC_A1, rvb->FB_SRC_B0, rvb->FB_SRC_B1,
+  rvb->MIX_DEST_A0, rvb->MIX_DEST_A1, rvb->MIX_DEST_B0, rvb->MIX_DEST_B1,
+ };
+ unsigned short *tap[TAP_COUNT];
  int IIR_ALPHA = rvb->IIR_ALPHA;
  int IIR_COEF = rvb->IIR_COEF;
  int space = 0x40000 - rvb->StartAddr;
- int l, r, ns;
+ int l, r, i, len, ns = 0;
 
- for (ns = 0; ns < ns_to * 2; )
+ // one reverb sample per 4 SSumLR entries (22kHz stereo vs 44kHz stereo)
+ while (ns < ns_to * 2)
   {
-   int ACC0, ACC1, FB_A0, FB_A1, FB_B0, FB_B1;
-   int mix_dest_a0, mix_dest_a1, mix_dest_b0, mix_dest_b1;
-
-   int input_L = RVB[ns]   * rvb->IN_COEF_L;
-   int input_R = RVB[ns+1] * rvb->IN_COEF_R;
-
-   int IIR_INPUT_A0 = ((g_buffer(IIR_SRC_A0) * IIR_COEF) + input_L) >> 15;
-   int IIR_INPUT_A1 = ((g_buffer(IIR_SRC_A1) * IIR_COEF) + input_R) >> 15;
-   int IIR_INPUT_B0 = ((g_buffer(IIR_SRC_B0) * IIR_COEF) + input_L) >> 15;
-   int IIR_INPUT_B1 = ((g_buffer(IIR_SRC_B1) * IIR_COEF) + input_R) >> 15;
-
-   int iir_dest_a0 = g_buffer(IIR_DEST_A0);
-   int iir_dest_a1 = g_buffer(IIR_DEST_A1);
-   int iir_dest_b0 = g_buffer(IIR_DEST_B0);
-   int iir_dest_b1 = g_buffer(IIR_DEST_B1);
-
-   int IIR_A0 = iir_dest_a0 + ((IIR_INPUT_A0 - iir_dest_a0) * IIR_ALPHA >> 15);
-   int IIR_A1 = iir_dest_a1 + ((IIR_INPUT_A1 - iir_dest_a1) * IIR_ALPHA >> 15);
-   int IIR_B0 = iir_dest_b0 + ((IIR_INPUT_B0 - iir_dest_b0) * IIR_ALPHA >> 15);
-   int IIR_B1 = iir_dest_b1 + ((IIR_INPUT_B1 - iir_dest_b1) * IIR_ALPHA >> 15);
-
-   preload(SSumLR + ns + 64*2/4 - 4);
-
-   s_buffer1(IIR_DEST_A0, IIR_A0);
-   s_buffer1(IIR_DEST_A1, IIR_A1);
-   s_buffer1(IIR_DEST_B0, IIR_B0);
-   s_buffer1(IIR_DEST_B1, IIR_B1);
-
-   preload(RVB + ns + 64*2/4 - 4);
-
-   ACC0 = (g_buffer(ACC_SRC_A0) * rvb->ACC_COEF_A +
-           g_buffer(ACC_SRC_B0) * rvb->ACC_COEF_B +
-           g_buffer(ACC_SRC_C0) * rvb->ACC_COEF_C +
-           g_buffer(ACC_SRC_D0) * rvb->ACC_COEF_D) >> 15;
-   ACC1 = (g_buffer(ACC_SRC_A1) * rvb->ACC_COEF_A +
-           g_buffer(ACC_SRC_B1) * rvb->ACC_COEF_B +
-           g_buffer(ACC_SRC_C1) * rvb->ACC_COEF_C +
-           g_buffer(ACC_SRC_D1) * rvb->ACC_COEF_D) >> 15;
-
-   FB_A0 = g_buffer(FB_SRC_A0);
-   FB_A1 = g_buffer(FB_SRC_A1);
-   FB_B0 = g_buffer(FB_SRC_B0);
-   FB_B1 = g_buffer(FB_SRC_B1);
-
-   mix_dest_a0 = ACC0 - ((FB_A0 * rvb->FB_ALPHA) >> 15);
-   mix_dest_a1 = ACC1 - ((FB_A1 * rvb->FB_ALPHA) >> 15);
-
-   mix_dest_b0 = FB_A0 + (((ACC0 - FB_A0) * rvb->FB_ALPHA - FB_B0 * rvb->FB_X) >> 15);
-   mix_dest_b1 = FB_A1 + (((ACC1 - FB_A1) * rvb->FB_ALPHA - FB_B1 * rvb->FB_X) >> 15);
-
-   s_buffer(MIX_DEST_A0, mix_dest_a0);
-   s_buffer(MIX_DEST_A1, mix_dest_a1);
-   s_buffer(MIX_DEST_B0, mix_dest_b0);
-   s_buffer(MIX_DEST_B1, mix_dest_b1);
-
-   l = (mix_dest_a0 + mix_dest_b0) / 2;
-   r = (mix_dest_a1 + mix_dest_b1) / 2;
-
-   l = (l * rvb->VolLeft)  >> 15; // 15?
-   r = (r * rvb->VolRight) >> 15;
-
-   SSumLR[ns++] += l;
-   SSumLR[ns++] += r;
-   SSumLR[ns++] += l;
-   SSumLR[ns++] += r;
-
-   curr_addr++;
+   len = rvb_setup_taps(tap, offs, TAP_COUNT, curr_addr, space,
+                        (ns_to * 2 - ns + 3) / 4);
+
+   for (i = 0; i < len; i++)
+    {
+     int ACC0, ACC1, FB_A0, FB_A1, FB_B0, FB_B1;
+     int mix_dest_a0, mix_dest_a1, mix_dest_b0, mix_dest_b1;
+
+     int input_L = RVB[ns]   * rvb->IN_COEF_L;
+     int input_R = RVB[ns+1] * rvb->IN_COEF_R;
+
+     int IIR_INPUT_A0 = ((g_buffer(IIR_SRC_A0) * IIR_COEF) + input_L) >> 15;
+     int IIR_INPUT_A1 = ((g_buffer(IIR_SRC_A1) * IIR_COEF) + input_R) >> 15;
+     int IIR_INPUT_B0 = ((g_buffer(IIR_SRC_B0) * IIR_COEF) + input_L) >> 15;
+     int IIR_INPUT_B1 = ((g_buffer(IIR_SRC_B1) * IIR_COEF) + input_R) >> 15;
+
+     int iir_dest_a0 = g_buffer(IIR_DEST_A0);
+     int iir_dest_a1 = g_buffer(IIR_DEST_A1);
+     int iir_dest_b0 = g_buffer(IIR_DEST_B0);
+     int iir_dest_b1 = g_buffer(IIR_DEST_B1);
+
+     int IIR_A0 = iir_dest_a0 + ((IIR_INPUT_A0 - iir_dest_a0) * IIR_ALPHA >> 15);
+     int IIR_A1 = iir_dest_a1 + ((IIR_INPUT_A1 - iir_dest_a1) * IIR_ALPHA >> 15);
+     int IIR_B0 = iir_dest_b0 + ((IIR_INPUT_B0 - iir_dest_b0) * IIR_ALPHA >> 15);
+     int IIR_B1 = iir_dest_b1 + ((IIR_INPUT_B1 - iir_dest_b1) * IIR_ALPHA >> 15);
+
+     preload(SSumLR + ns + 64*2/4 - 4);
+
+     s_buffer(IIR_NEXT_A0, IIR_A0);
+     s_buffer(IIR_NEXT_A1, IIR_A1);
+     s_buffer(IIR_NEXT_B0, IIR_B0);
+     s_buffer(IIR_NEXT_B1, IIR_B1);
+
+     preload(RVB + ns + 64*2/4 - 4);
+
+     ACC0 = (g_buffer(ACC_SRC_A0) * rvb->ACC_COEF_A +
+             g_buffer(ACC_SRC_B0) * rvb->ACC_COEF_B +
+             g_buffer(ACC_SRC_C0) * rvb->ACC_COEF_C +
+             g_buffer(ACC_SRC_D0) * rvb->ACC_COEF_D) >> 15;
+     ACC1 = (g_buffer(ACC_SRC_A1) * rvb->ACC_COEF_A +
+             g_buffer(ACC_SRC_B1) * rvb->ACC_COEF_B +
+             g_buffer(ACC_SRC_C1) * rvb->ACC_COEF_C +
+             g_buffer(ACC_SRC_D1) * rvb->ACC_COEF_D) >> 15;
+
+     FB_A0 = g_buffer(FB_SRC_A0);
+     FB_A1 = g_buffer(FB_SRC_A1);
+     FB_B0 = g_buffer(FB_SRC_B0);
+     FB_B1 = g_buffer(FB_SRC_B1);
+
+     mix_dest_a0 = ACC0 - ((FB_A0 * rvb->FB_ALPHA) >> 15);
+     mix_dest_a1 = ACC1 - ((FB_A1 * rvb->FB_ALPHA) >> 15);
+
+     mix_dest_b0 = FB_A0 + (((ACC0 - FB_A0) * rvb->FB_ALPHA - FB_B0 * rvb->FB_X) >> 15);
+     mix_dest_b1 = FB_A1 + (((ACC1 - FB_A1) * rvb->FB_ALPHA - FB_B1 * rvb->FB_X) >> 15);
+
+     s_buffer(MIX_DEST_A0, mix_dest_a0);
+     s_buffer(MIX_DEST_A1, mix_dest_a1);
+     s_buffer(MIX_DEST_B0, mix_dest_b0);
+     s_buffer(MIX_DEST_B1, mix_dest_b1);
+
+     l = (mix_dest_a0 + mix_dest_b0) / 2;
+     r = (mix_dest_a1 + mix_dest_b1) / 2;
+
+     l = (l * rvb->VolLeft)  >> 15; // 15?
+     r = (r * rvb->VolRight) >> 15;
+
+     SSumLR[ns++] += l;
+     SSumLR[ns++] += r;
+     SSumLR[ns++] += l;
+     SSumLR[ns++] += r;
+    }
+
+   curr_addr += len;
    if (curr_addr >= 0x40000) curr_addr = rvb->StartAddr;
   }
 }
@@ -149,29 +194,43 @@ static void MixREVERB(int *SSumLR, int *RVB, int ns_to, int curr_addr)
 static void MixREVERB_off(int *SSumLR, int ns_to, int curr_addr)
 {
  const REVERBInfo *rvb = spu.rvb;
+ const int offs[TAP_COUNT] = {
+  [TAP_MIX_DEST_A0] = rvb->MIX_DEST_A0, [TAP_MIX_DEST_A1] = rvb->MIX_DEST_A1,
+  [TAP_MIX_DEST_B0] = rvb->MIX_DEST_B0, [TAP_MIX_DEST_B1] = rvb->MIX_DEST_B1,
+ };
+ unsigned short *tap[TAP_COUNT];
  int space = 0x40000 - rvb->StartAddr;
- int l, r, ns;
+ int l, r, i, len, ns = 0;
 
- for (ns = 0; ns < ns_to * 2; )
+ while (ns < ns_to * 2)
   {
-   preload(SSumLR + ns + 64*2/4 - 4);
+   len = rvb_setup_taps(tap + TAP_MIX_DEST_A0, offs + TAP_MIX_DEST_A0, 4,
+                        curr_addr, space, (ns_to * 2 - ns + 3) / 4);
+
+   for (i = 0; i < len; i++)
+    {
+     preload(SSumLR + ns + 64*2/4 - 4);
 
-   l = (g_buffer(MIX_DEST_A0) + g_buffer(MIX_DEST_B0)) / 2;
-   r = (g_buffer(MIX_DEST_A1) + g_buffer(MIX_DEST_B1)) / 2;
+     l = (g_buffer(MIX_DEST_A0) + g_buffer(MIX_DEST_B0)) / 2;
+     r = (g_buffer(MIX_DEST_A1) + g_buffer(MIX_DEST_B1)) / 2;
 
-   l = (l * rvb->VolLeft)  >> 15;
-   r = (r * rvb->VolRight) >> 15;
+     l = (l * rvb->VolLeft)  >> 15;
+     r = (r * rvb->VolRight) >> 15;
 
-   SSumLR[ns++] += l;
-   SSumLR[ns++] += r;
-   SSumLR[ns++] += l;
-   SSumLR[ns++] += r;
+     SSumLR[ns++] += l;
+     SSumLR[ns++] += r;
+     SSumLR[ns++] += l;
+     SSumLR[ns++] += r;
+    }
 
-   curr_addr++;
+   curr_addr += len;
    if (curr_addr >= 0x40000) curr_addr = rvb->StartAddr;
   }
 }
 
+#undef g_buffer
+#undef s_buffer
+
 static void REVERBPrep(void)
 {
  REVERBInfo *rvb = spu.rvb;
@@ -77,6 +77,72 @@ int ChanBuf[NSSIZE];
 
 #define CDDA_BUFFER_SIZE (16384 * sizeof(uint32_t)) // must be power of 2
 
+// decoded ADPCM blocks, so that looping samples aren't decoded again
+// on every pass; see decode_block_cached()
+#define ADPCM_CACHE_SIZE 256                   // must be power of 2
+
+static struct adpcm_cache_entry {
+ unsigned int addr;                            // block offset, 0: free
+ int s_1, s_2;                                 // history used for decoding
+ int pcm[28];
+} adpcm_cache[ADPCM_CACHE_SIZE];
+
+static uint32_t adpcm_cached_blocks[0x80000 / 16 / 32];
+static int adpcm_cache_rvb_addr = 0x40000;     // reverb writes from here
+
+static void adpcm_cache_invalidate_range(unsigned int first, unsigned int last)
+{
+ unsigned int b, i, hit = 0;
+
+ for (b = first; b <= last; b++)
+ {
+  uint32_t *w = &adpcm_cached_blocks[b >> 5];
+  if (!(b & 31) && b + 31 <= last && !*w) {
+   b += 31;
+   continue;
+  }
+  if (*w & (1u << (b & 31))) {
+   *w &= ~(1u << (b & 31));
+   hit = 1;
+  }
+ }
+ if (!hit)
+  return;
+
+ for (i = 0; i < ADPCM_CACHE_SIZE; i++)
+ {
+  b = adpcm_cache[i].addr >> 4;
+  if (first <= b && b <= last)
+   adpcm_cache[i].addr = 0;
+ }
+}
+
+// must be called for any write to SPU RAM, except the ones done by
+// the decode buffers and reverb, which are never cached
+void adpcm_cache_invalidate(unsigned int addr, unsigned int len)
+{
+ addr &= 0x7ffff;
+ if (!len)
+  return;
+ if (addr + len > 0x80000) {
+  adpcm_cache_invalidate_range(0, (addr + len - 0x80000 - 1) >> 4);
+  len = 0x80000 - addr;
+ }
+ adpcm_cache_invalidate_range(addr >> 4, (addr + len - 1) >> 4);
+}
+
+// reverb may write its work area, drop anything cached there.
+// Must run on the main thread, before the work is handed to the worker.
+static void adpcm_cache_reverb_on(void)
+{
+ int start = spu.rvb->StartAddr;
+
+ if (start < adpcm_cache_rvb_addr) {
+  adpcm_cache_invalidate(start * 2, (adpcm_cache_rvb_addr - start) * 2);
+  adpcm_cache_rvb_addr = start;
+ }
+}
+
 ////////////////////////////////////////////////////////////////////////
 // CODE AREA
 ////////////////////////////////////////////////////////////////////////
@@ -377,11 +443,46 @@ static void decode_block_data(int *dest, const unsigned char *src, int predict_n
  }
 }
 
+// the output only depends on the block data and, for filters 1-4, on
+// the last two samples of the previous block
+static void decode_block_cached(int *SB, const unsigned char *start)
+{
+ unsigned int addr = start - spu.spuMemC;
+ int predict_nr = start[0] >> 4, shift_factor = start[0] & 0xf;
+ struct adpcm_cache_entry *e;
+ int s_1 = 0, s_2 = 0;
+
+ if (addr < 0x1000 || addr >= adpcm_cache_rvb_addr * 2u) {
+  decode_block_data(SB, start + 2, predict_nr, shift_factor);
+  return;
+ }
+
+ if (predict_nr >= 1 && predict_nr <= 4) {
+  s_1 = SB[27];
+  s_2 = SB[26];
+ }
+
+ e = &adpcm_cache[((addr >> 4) ^ (unsigned int)s_1 ^ ((unsigned int)s_2 << 3))
+                  & (ADPCM_CACHE_SIZE - 1)];
+ if (e->addr == addr && e->s_1 == s_1 && e->s_2 == s_2) {
+  memcpy(SB, e->pcm, sizeof(e->pcm));
+  return;
+ }
+
+ decode_block_data(SB, start + 2, predict_nr, shift_factor);
+
+ e->addr = addr;
+ e->s_1 = s_1;
+ e->s_2 = s_2;
+ memcpy(e->pcm, SB, sizeof(e->pcm));
+ adpcm_cached_blocks[addr >> 9] |= 1u << ((addr >> 4) & 31);
+}
+
 static int decode_block(void *unused, int ch, int *SB)
 {
  SPUCHAN *s_chan = &spu.s_chan[ch];
  unsigned char *start;
- int predict_nr, shift_factor, flags;
+ int flags;
  int ret = 0;
 
  start = s_chan->pCurr;                    // set up the current pos
@@ -401,11 +502,7 @@ static int decode_block(void *unused, int ch, int *SB)
 
  check_irq(ch, start);
 
- predict_nr = start[0];
- shift_factor = predict_nr & 0xf;
- predict_nr >>= 4;
-
- decode_block_data(SB, start + 2, predict_nr, shift_factor);
+ decode_block_cached(SB, start);
 
  flags = start[1];
  if (flags & 4 && !s_chan->bIgnoreLoop)
@@ -558,24 +655,177 @@ make_do_samples(do_samples_fmod,
   StoreInterpolationGaussCubic(sb, fa),
   dst[ns] = GetInterpolationGauss(sb, *spos), )
 
+// variants of the above for the common pitch classes, selected by
+// do_samples_adpcm(); the output is the same as the generic loop's
+#define do_samples_fetch                     \
+   fa = sb->SB[(*sbpos)++];                  \
+   if (*sbpos >= 28)                         \
+   {                                         \
+    *sbpos = 0;                              \
+    d = decode_f(ctx, ch, sb->SB);           \
+    if (d && ns < ret)                       \
+     ret = ns;                               \
+   }
+
+// upsampling: at most one new sample per output
+#define make_do_samples_up(name, interp_start, interp_store, interp_get, interp_end) \
+static noinline int name(int *dst, \
+ int (*decode_f)(void *context, int ch, int *SB), void *ctx, \
+ int ch, int ns_to, sample_buf *sb, int sinc, int *spos, int *sbpos) \
+{                                            \
+ int ns, d, fa;                              \
+ int ret = ns_to;                            \
+ interp_start;                               \
+                                             \
+ for (ns = 0; ns < ns_to; ns++)              \
+ {                                           \
+  *spos += sinc;                             \
+  if (*spos >= 0x10000)                      \
+  {                                          \
+   do_samples_fetch                          \
+   interp_store;                             \
+   *spos -= 0x10000;                         \
+  }                                          \
+                                             \
+  interp_get;                                \
+ }                                           \
+                                             \
+ interp_end;                                 \
+                                             \
+ return ret;                                 \
+}
+
+// integer ratio: sinc >> 16 new samples per output, and as the position
+// within the sample never changes, neither does the filter phase
+#define make_do_samples_int(name, interp_start, interp_store, interp_get, interp_end) \
+static noinline int name(int *dst, \
+ int (*decode_f)(void *context, int ch, int *SB), void *ctx, \
+ int ch, int ns_to, sample_buf *sb, int sinc, int *spos, int *sbpos) \
+{                                            \
+ const int pos = *spos, step = sinc >> 16;   \
+ int ns, d, fa, i;                           \
+ int ret = ns_to;                            \
+ interp_start;                               \
+                                             \
+ for (ns = 0; ns < ns_to; ns++)              \
+ {                                           \
+  for (i = 0; i < step; i++)                 \
+  {                                          \
+   do_samples_fetch                          \
+   interp_store;                             \
+  }                                          \
+                                             \
+  interp_get;                                \
+ }                                           \
+                                             \
+ interp_end;                                 \
+                                             \
+ return ret;                                 \
+}
+
+make_do_samples_up(do_samples_nointerp_up, fa = sb->SB[29],
+   , dst[ns] = fa, sb->SB[29] = fa)
+make_do_samples_up(do_samples_simple_up, ,
+  simple_interp_store, simple_interp_get, )
+
+make_do_samples_int(do_samples_nointerp_int, fa = sb->SB[29],
+   , dst[ns] = fa, sb->SB[29] = fa)
+make_do_samples_int(do_samples_simple_int, ,
+  simple_interp_store, simple_interp_get, )
+make_do_samples_int(do_samples_gauss_int, ,
+  StoreInterpolationGaussCubic(sb, fa),
+  dst[ns] = GetInterpolationGauss(sb, pos), )
+make_do_samples_int(do_samples_cubic_int, ,
+  StoreInterpolationGaussCubic(sb, fa),
+  dst[ns] = GetInterpolationCubic(sb, pos), )
+
+// 1:1 without interpolation: the decoded samples are copied as they are
+static noinline int do_samples_copy(int *dst,
+ int (*decode_f)(void *context, int ch, int *SB), void *ctx,
+ int ch, int ns_to, sample_buf *sb, int sinc, int *spos, int *sbpos)
+{
+ int ns = 0, n, d;
+ int ret = ns_to;
+
+ while (ns < ns_to)
+ {
+  n = 28 - *sbpos;
+  if (n > ns_to - ns)
+   n = ns_to - ns;
+
+  memcpy(dst + ns, sb->SB + *sbpos, n * sizeof(dst[0]));
+  *sbpos += n;
+  ns += n;
+
+  if (*sbpos >= 28)
+  {
+   *sbpos = 0;
+   d = decode_f(ctx, ch, sb->SB);
+   if (d && ns - 1 < ret)
+    ret = ns - 1;
+  }
+ }
+
+ if (ns_to > 0)
+  sb->SB[29] = dst[ns_to - 1];
+
+ return ret;
+}
+
+enum {
+ PITCH_ANY,
+ PITCH_UP,                                 // sinc < 0x10000
+ PITCH_INT,                                // sinc multiple of 0x10000
+};
+
 INLINE int do_samples_adpcm(int *dst,
  int (*decode_f)(void *context, int ch, int *SB), void *ctx,
  int ch, int ns_to, int fmod, sample_buf *sb, int sinc, int *spos, int *sbpos)
 {
  int interp = spu.interpolation;
+ int pitch = PITCH_ANY;
  if (fmod == 1)
   return do_samples_fmod(dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
  if (fmod)
   interp = 2;
+ if (*spos < 0x10000 && *sbpos < 28) {
+  if (!(sinc & 0xffff))
+   pitch = PITCH_INT;
+  else if (sinc < 0x10000)
+   pitch = PITCH_UP;
+ }
+ if (pitch == PITCH_INT) {
+  switch (interp) {
+   case 0:
+    if (sinc == 0x10000)
+     return do_samples_copy(dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
+    return do_samples_nointerp_int(dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
+   case 1:
+    return do_samples_simple_int  (dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
+   case 3:
+    return do_samples_cubic_int   (dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
+   default:
+    return do_samples_gauss_int   (dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
+  }
+ }
+ if (pitch == PITCH_UP) {
+  switch (interp) {
+   case 0:
+    return do_samples_nointerp_up(dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
+   case 1:
+    return do_samples_simple_up  (dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
+   // gauss/cubic gain nothing here, the filter dominates
+  }
+ }
  switch (interp) {
   case 0:
    return do_samples_nointerp(dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
   case 1:
    return do_samples_simple  (dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
-  default:
-   return do_samples_gauss   (dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
   case 3:
    return do_samples_cubic   (dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
+  default:
+   return do_samples_gauss   (dst, decode_f, ctx, ch, ns_to, sb, sinc, spos, sbpos);
  }
 }
 
@@ -1229,6 +1479,10 @@ void do_samples(unsigned int cycles_to, int force_no_thread)
   if (unlikely(spu.rvb->dirty))
    REVERBPrep();
 
+  // not checking CTRL bit 7 here: the worker reads it later
+  if (spu.rvb->StartAddr && spu_config.iUseReverb)
+   adpcm_cache_reverb_on();
+
   if (force_no_thread || worker == NULL || !spu_config.iUseThread) {
    do_channels(ns_to);
    do_samples_finish(spu.SSumLR, ns_to, silentch, spu.decode_pos);
@@ -1586,6 +1840,10 @@ long CALLBACK SPUinit(void)
 
  InitADSR();
 
+ memset(adpcm_cache, 0, sizeof(adpcm_cache));
+ memset(adpcm_cached_blocks, 0, sizeof(adpcm_cached_blocks));
+ adpcm_cache_rvb_addr = 0x40000;
+
  spu.s_chan = calloc(MAXCHAN+1, sizeof(spu.s_chan[0])); // channel + 1 infos (1 is security for fmod handling)
  spu.rvb = calloc(1, sizeof(REVERBInfo));
 
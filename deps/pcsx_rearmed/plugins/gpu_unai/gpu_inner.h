@@ -60,6 +60,12 @@
 #include "gpu_inner_light_arm.h"
 #define gpuBlending gpuBlendingARM
 #define gpuLightingTXT gpuLightingTXTARM
+#elif defined(__sh__)
+#include "gpu_inner_blend_sh4.h"
+#include "gpu_inner_light_sh4.h"
+#include "gpu_inner_span_sh4.h"
+#define gpuBlending gpuBlendingSH4
+#define gpuLightingTXT gpuLightingTXTSH4
 #else
 #define gpuBlending gpuBlendingGeneric
 #define gpuLightingTXT gpuLightingTXTGeneric
@@ -285,7 +291,11 @@ static void gpuTileSpanFn(le16_t *pDst, u32 count, u16 data)
 			ldata = u16_to_le16(data | 0x8000);
 		else
 			ldata = u16_to_le16(data);
+#ifdef __sh__
+		gpuTileFillSH4(pDst, count, ldata);
+#else
 		do { *pDst++ = ldata; } while (--count);
+#endif
 	} else if (CF_MASKCHECK && !CF_BLEND) {
 		if (CF_MASKSET)
 			ldata = u16_to_le16(data | 0x8000);
@@ -0,0 +1,107 @@
+#ifndef _OP_BLEND_SH4_H_
+#define _OP_BLEND_SH4_H_
+
+////////////////////////////////////////////////////////////////////////////////
+// Blend bgr555 color in 'uSrc' (foreground) with bgr555 color
+//  in 'uDst' (background), returning resulting color.
+//
+// INPUT:
+//  'uSrc','uDst' input: -bbbbbgggggrrrrr
+//                       ^ bit 16
+// OUTPUT:
+//           u16 output: 0bbbbbgggggrrrrr
+//                       ^ bit 16
+// RETURNS:
+// Where '0' is zero-padding, and '-' is don't care
+//
+// Same results as gpuBlendingGeneric(). SH has two-operand instructions and
+//  only 1/2/8/16-bit immediate shifts, so the clamping sequences are
+//  scheduled by hand to pair in the SH4 dual-issue pipeline, with the
+//  0x0421/0x8420 masks kept in registers across the span loop.
+////////////////////////////////////////////////////////////////////////////////
+template <int BLENDMODE, bool SKIP_USRC_MSB_MASK>
+GPU_INLINE uint_fast16_t gpuBlendingSH4(uint_fast16_t uSrc, uint_fast16_t uDst)
+{
+	u32 s = uSrc, d = uDst, mix, tmp;
+
+	// 0.5 x Back + 0.5 x Forward
+	if (BLENDMODE==0) {
+#ifdef GPU_UNAI_USE_ACCURATE_BLENDING
+		// Slower, but more accurate (doesn't lose LSB data)
+		d &= 0x7fff;
+		if (!SKIP_USRC_MSB_MASK)
+			s &= 0x7fff;
+		return ((s + d) - ((s ^ d) & 0x0421)) >> 1;
+#else
+		// GCC already emits the optimal and/and/add/shlr sequence
+		return ((d & 0x7bde) + (s & 0x7bde)) >> 1;
+#endif
+	}
+
+	d &= 0x7fff;
+	if (BLENDMODE==3)
+		s = (s >> 2) & 0x1ce7;
+	else if (!SKIP_USRC_MSB_MASK)
+		s &= 0x7fff;
+
+	// 1.0 x Back + 1.0 x Forward, 1.0 x Back + 0.25 x Forward
+	if (BLENDMODE==1 || BLENDMODE==3) {
+		// u32 sum      = uSrc + uDst;
+		// u32 low_bits = (uSrc ^ uDst) & 0x0421;
+		// u32 carries  = (sum - low_bits) & 0x8420;
+		// u32 modulo   = sum - carries;
+		// u32 clamp    = carries - (carries >> 5);
+		// mix = modulo | clamp;
+		asm ("mov    %[s], %[mix]\n\t"
+		     "xor    %[d], %[mix]\n\t"      // uSrc ^ uDst
+		     "add    %[d], %[s]\n\t"        // sum = uSrc + uDst
+		     "and    %[lo], %[mix]\n\t"     // low_bits = ... & 0x0421
+		     "mov    %[s], %[tmp]\n\t"
+		     "sub    %[mix], %[tmp]\n\t"    // sum - low_bits
+		     "and    %[hi], %[tmp]\n\t"     // carries = ... & 0x8420
+		     "mov    %[tmp], %[mix]\n\t"
+		     "shlr2  %[mix]\n\t"
+		     "sub    %[tmp], %[s]\n\t"      // modulo = sum - carries
+		     "shlr2  %[mix]\n\t"
+		     "shlr   %[mix]\n\t"            // carries >> 5
+		     "sub    %[mix], %[tmp]\n\t"    // clamp = carries - (carries >> 5)
+		     "or     %[tmp], %[s]\n\t"      // mix = modulo | clamp
+		     : [s] "+&r" (s), [mix] "=&r" (mix), [tmp] "=&r" (tmp)
+		     : [d] "r" (d), [lo] "r" (0x0421u), [hi] "r" (0x8420u)
+		     : "t");
+		return s;
+	}
+
+	// 1.0 x Back - 1.0 x Forward
+	if (BLENDMODE==2) {
+		// u32 diff     = uDst - uSrc + 0x8420;
+		// u32 low_bits = (uDst ^ uSrc) & 0x8420;
+		// u32 borrows  = (diff - low_bits) & 0x8420;
+		// u32 modulo   = diff - borrows;
+		// u32 clamp    = borrows - (borrows >> 5);
+		// mix = modulo & clamp;
+		asm ("mov    %[d], %[mix]\n\t"
+		     "xor    %[s], %[mix]\n\t"      // uDst ^ uSrc
+		     "sub    %[s], %[d]\n\t"        // uDst - uSrc
+		     "and    %[hi], %[mix]\n\t"     // low_bits = ... & 0x8420
+		     "add    %[hi], %[d]\n\t"       // diff = ... + 0x8420
+		     "mov    %[d], %[tmp]\n\t"
+		     "sub    %[mix], %[tmp]\n\t"    // diff - low_bits
+		     "and    %[hi], %[tmp]\n\t"     // borrows = ... & 0x8420
+		     "mov    %[tmp], %[mix]\n\t"
+		     "shlr2  %[mix]\n\t"
+		     "sub    %[tmp], %[d]\n\t"      // modulo = diff - borrows
+		     "shlr2  %[mix]\n\t"
+		     "shlr   %[mix]\n\t"            // borrows >> 5
+		     "sub    %[mix], %[tmp]\n\t"    // clamp = borrows - (borrows >> 5)
+		     "and    %[tmp], %[d]\n\t"      // mix = modulo & clamp
+		     : [d] "+&r" (d), [mix] "=&r" (mix), [tmp] "=&r" (tmp)
+		     : [s] "r" (s), [hi] "r" (0x8420u)
+		     : "t");
+		return d;
+	}
+
+	return s;
+}
+
+#endif  //_OP_BLEND_SH4_H_
@@ -0,0 +1,57 @@
+#ifndef _OP_LIGHT_SH4_H_
+#define _OP_LIGHT_SH4_H_
+
+////////////////////////////////////////////////////////////////////////////////
+// Apply fast (low-precision) 5-bit lighting to bgr555 texture color:
+//
+// INPUT:
+//        'r5','g5','b5' are unsigned 5-bit color values, value of 15
+//          is midpoint that doesn't modify that component of texture
+//        'uSrc' input:  -bbbbbgggggrrrrr
+//                       ^ bit 16
+// RETURNS:
+//          u16 output:  mbbbbbgggggrrrrr
+//
+// Same results as gpuLightingTXTGeneric(). The LUT lookups use the r0-indexed
+//  mov.b, and skip the extu.b GCC emits after each one: mov.b sign-extends,
+//  which is harmless as LightLUT[] entries are all in the 0..31 range.
+////////////////////////////////////////////////////////////////////////////////
+GPU_INLINE uint_fast16_t gpuLightingTXTSH4(uint_fast16_t uSrc, u8 r5, u8 g5, u8 b5)
+{
+	u32 out, idx, tmp;
+
+	asm ("mov    %[src], %[idx]\n\t"
+	     "shll2  %[idx]\n\t"
+	     "shll2  %[idx]\n\t"
+	     "shll   %[idx]\n\t"                    // idx = uSrc << 5
+	     "and    %[mask], %[idx]\n\t"           // idx = 0000rrrrr00000
+	     "or     %[r5], %[idx]\n\t"             // idx = 0000rrrrrRRRRR
+	     "mov.b  @(%[idx],%[lut]), %[out]\n\t"  // out = 00000000000rrrrr
+	     "mov    %[src], %[idx]\n\t"
+	     "and    %[mask], %[idx]\n\t"           // idx = 0000ggggg00000
+	     "or     %[g5], %[idx]\n\t"             // idx = 0000gggggGGGGG
+	     "mov.b  @(%[idx],%[lut]), %[tmp]\n\t"  // tmp = 00000000000ggggg
+	     "mov    %[src], %[idx]\n\t"
+	     "shlr2  %[idx]\n\t"
+	     "shlr2  %[idx]\n\t"
+	     "shlr   %[idx]\n\t"                    // idx = uSrc >> 5
+	     "shll2  %[tmp]\n\t"
+	     "shll2  %[tmp]\n\t"
+	     "shll   %[tmp]\n\t"                    // tmp = 000000ggggg00000
+	     "and    %[mask], %[idx]\n\t"           // idx = 0000bbbbb00000
+	     "or     %[tmp], %[out]\n\t"            // out = 000000gggggrrrrr
+	     "or     %[b5], %[idx]\n\t"             // idx = 0000bbbbbBBBBB
+	     "mov.b  @(%[idx],%[lut]), %[tmp]\n\t"  // tmp = 00000000000bbbbb
+	     "shll8  %[tmp]\n\t"
+	     "shll2  %[tmp]\n\t"                    // tmp = 0bbbbb0000000000
+	     "or     %[tmp], %[out]\n\t"            // out = 0bbbbbgggggrrrrr
+	     : [out] "=&r" (out), [idx] "=&z" (idx), [tmp] "=&r" (tmp)
+	     : [src] "r" ((u32)uSrc), [mask] "r" (0x03e0u),
+	       [r5] "r" ((u32)r5), [g5] "r" ((u32)g5), [b5] "r" ((u32)b5),
+	       [lut] "r" (gpu_unai.LightLUT)
+	     : "t", "memory");
+
+	return out | (uSrc & 0x8000);
+}
+
+#endif  //_OP_LIGHT_SH4_H_
@@ -0,0 +1,42 @@
+#ifndef _OP_SPAN_SH4_H_
+#define _OP_SPAN_SH4_H_
+
+////////////////////////////////////////////////////////////////////////////////
+// Fill 'count' (>= 1) pixels at 'pDst' with 'ldata'
+//
+// SH4 has no post-increment store, so after aligning 'pDst' the span is
+//  filled backwards two pixels at a time with a pre-decrement mov.l in a
+//  'dt' loop. The 32-bit pattern is built with swap.w.
+////////////////////////////////////////////////////////////////////////////////
+GPU_INLINE void gpuTileFillSH4(le16_t *pDst, u32 count, le16_t ldata)
+{
+	u32 col = le16_raw(ldata), col32, pairs;
+	le16_t *end;
+
+	if ((uintptr_t)pDst & 2) {
+		*pDst++ = ldata;
+		if (!--count)
+			return;
+	}
+
+	end = pDst + count;
+	if (count & 1)
+		*--end = ldata;
+
+	pairs = count >> 1;
+	if (!pairs)
+		return;
+
+	asm volatile ("swap.w  %[col], %[col32]\n\t"
+		      "or      %[col], %[col32]\n"
+		      "1:\n\t"
+		      "mov.l   %[col32], @-%[end]\n\t"
+		      "dt      %[pairs]\n\t"
+		      "bf      1b\n\t"
+		      : [end] "+r" (end), [pairs] "+r" (pairs),
+			[col32] "=&r" (col32)
+		      : [col] "r" (col)
+		      : "t", "memory");
+}
+
+#endif  //_OP_SPAN_SH4_H_
@@ -438,6 +438,26 @@ static inline void do_vram_line(int x, int y, uint16_t *mem, int l,
     memcpy(vram, mem, l * 2);
 }
 
+// pass the lines written so far to the renderer in bands of this many lines,
+// so that it can update its caches while the data is still in the CPU cache.
+// 16 matches the PVR renderer's texture bands (TEXTURE_BAND_HEIGHT), so each
+// band is converted and checksummed once. 16 lines of a 256-pixel wide
+// upload are 8 KiB: the band fits in the SH4's 16 KiB operand cache next to
+// the source data, while 32 lines would fill it.
+#define VRAM_WRITE_BAND 16
+
+static void report_vram_write(int h_left)
+{
+  int done = gpu.dma_start.h - h_left;
+  int reported = gpu.dma.lines_reported;
+
+  if (done > reported) {
+    renderer_update_caches(gpu.dma_start.x, (gpu.dma_start.y + reported) & 511,
+                           gpu.dma_start.w, done - reported, 0);
+    gpu.dma.lines_reported = done;
+  }
+}
+
 static int do_vram_io(uint32_t *data, int count, int is_read)
 {
   int count_initial = count;
@@ -472,6 +492,8 @@ static int do_vram_io(uint32_t *data, int count, int is_read)
   for (; h > 0 && count >= w; sdata += w, count -= w, y++, h--) {
     y &= 511;
     do_vram_line(x, y, sdata, w, is_read, r6);
+    if (!is_read && (y & (VRAM_WRITE_BAND - 1)) == VRAM_WRITE_BAND - 1)
+      report_vram_write(h - 1);
   }
 
   if (h > 0) {
@@ -502,6 +524,7 @@ static void start_vram_transfer(uint32_t pos_word, uint32_t size_word, int is_re
   gpu.dma.h = (((size_word >> 16) - 1) & 0x1ff) + 1;
   gpu.dma.offset = 0;
   gpu.dma.is_read = is_read;
+  gpu.dma.lines_reported = 0;
   gpu.dma_start = gpu.dma;
 
   renderer_flush_queues();
@@ -524,13 +547,51 @@ static void finish_vram_transfer(int is_read)
     gpu.status &= ~PSX_GPU_STATUS_IMG;
   else {
     gpu.state.fb_dirty = 1;
-    renderer_update_caches(gpu.dma_start.x, gpu.dma_start.y,
-                           gpu.dma_start.w, gpu.dma_start.h, 0);
+    report_vram_write(0);
   }
   if (gpu.gpu_state_change)
     gpu.gpu_state_change(PGS_VRAM_TRANSFER_END);
 }
 
+// copy l pixels setting the mask bit, dst may only overlap src from below
+static void cpy_msb(uint16_t *dst, const uint16_t *src, uint32_t l)
+{
+  uint32_t i;
+  if (((uintptr_t)dst ^ (uintptr_t)src) & 2) {
+    for (i = 0; i < l; i++)
+      dst[i] = src[i] | 0x8000;
+    return;
+  }
+  if (((uintptr_t)dst & 2) && l) {
+    *dst++ = *src++ | 0x8000;
+    l--;
+  }
+  for (i = 0; i < l / 2; i++)
+    ((uint32_t *)dst)[i] = ((const uint32_t *)src)[i] | 0x80008000;
+  if (l & 1)
+    dst[l - 1] = src[l - 1] | 0x8000;
+}
+
+// copy l pixels between rows, splitting where either side wraps at 1024
+static void vram_copy_span(uint16_t *drow, uint32_t dx,
+    const uint16_t *srow, uint32_t sx, uint32_t l, uint16_t msb)
+{
+  while (l) {
+    uint32_t n = l;
+    if (n > 1024 - sx)
+      n = 1024 - sx;
+    if (n > 1024 - dx)
+      n = 1024 - dx;
+    if (msb)
+      cpy_msb(drow + dx, srow + sx, n);
+    else
+      memmove(drow + dx, srow + sx, n * 2);
+    sx = (sx + n) & 0x3ff;
+    dx = (dx + n) & 0x3ff;
+    l -= n;
+  }
+}
+
 static void do_vram_copy(const uint32_t *params, int *cpu_cycles)
 {
   const uint32_t sx =  LE32TOH(params[0]) & 0x3FF;
@@ -549,30 +610,30 @@ static void do_vram_copy(const uint32_t *params, int *cpu_cycles)
 
   renderer_flush_queues();
 
-  if (unlikely((sx < dx && dx < sx + w) || sx + w > 1024 || dx + w > 1024 || msb))
+  if (sy != dy || (sx + w <= 1024 && dx + w <= 1024 && !(sx < dx && dx < sx + w)))
+  {
+    // rows don't alias or only overlap leftwards, so a forward copy
+    // gives the same result as going through lbuf
+    for (y = 0; y < h; y++)
+      vram_copy_span(VRAM_MEM_XY(0, (dy + y) & 0x1ff), dx,
+        VRAM_MEM_XY(0, (sy + y) & 0x1ff), sx, w, msb);
+  }
+  else
   {
+    // overlapping within the same row, bounce through 128 pixel chunks
     for (y = 0; y < h; y++)
     {
-      const uint16_t *src = VRAM_MEM_XY(0, (sy + y) & 0x1ff);
-      uint16_t *dst = VRAM_MEM_XY(0, (dy + y) & 0x1ff);
+      uint16_t *row = VRAM_MEM_XY(0, (sy + y) & 0x1ff);
       for (x = 0; x < w; x += ARRAY_SIZE(lbuf))
       {
-        uint32_t x1, w1 = w - x;
+        uint32_t w1 = w - x;
         if (w1 > ARRAY_SIZE(lbuf))
           w1 = ARRAY_SIZE(lbuf);
-        for (x1 = 0; x1 < w1; x1++)
-          lbuf[x1] = src[(sx + x + x1) & 0x3ff];
-        for (x1 = 0; x1 < w1; x1++)
-          dst[(dx + x + x1) & 0x3ff] = lbuf[x1] | msb;
+        vram_copy_span(lbuf, 0, row, (sx + x) & 0x3ff, w1, 0);
+        vram_copy_span(row, (dx + x) & 0x3ff, lbuf, 0, w1, msb);
       }
     }
   }
-  else
-  {
-    uint32_t sy1 = sy, dy1 = dy;
-    for (y = 0; y < h; y++, sy1++, dy1++)
-      memcpy(VRAM_MEM_XY(dx, dy1 & 0x1ff), VRAM_MEM_XY(sx, sy1 & 0x1ff), w * 2);
-  }
 
   renderer_update_caches(dx, dy, w, h, 0);
 }
@@ -751,6 +812,15 @@ void GPUwriteData(uint32_t data)
     flush_cmd_buffer();
 }
 
+int GPUgetCmdBuffer(uint32_t **buffer, int **len)
+{
+  // for CPU emulators that append GP0 writes to the buffer by themselves;
+  // the buffer must be flushed (by calling GPUwriteData) once full
+  *buffer = gpu.cmd_buffer;
+  *len = &gpu.cmd_len;
+  return CMD_BUFFER_LEN;
+}
+
 long GPUdmaChain(uint32_t *rambase, uint32_t start_addr,
   uint32_t *progress_addr, int32_t *cycles_last_cmd)
 {
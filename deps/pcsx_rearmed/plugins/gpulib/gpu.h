@@ -68,6 +68,7 @@ struct psx_gpu {
   struct {
     int x, y, w, h;
     short int offset, is_read;
+    int lines_reported;
   } dma, dma_start;
   int cmd_len;
   uint32_t zero;
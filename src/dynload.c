@@ -43,6 +43,7 @@ void GPUupdateLace(void);
 void GPUdisplayText(char *);
 long GPUfreeze(unsigned long,void *);
 void GPUrearmedCallbacks(const void **cbs);
+int GPUgetCmdBuffer(uint32_t **buffer, int **len);
 
 
 /* PAD */
@@ -163,6 +164,7 @@ static const struct sym gpu_syms[] = {
 	BIND_SYM(GPUfreeze),
 	BIND_SYM(GPUupdateLace),
 	BIND_SYM(GPUrearmedCallbacks),
+	BIND_SYM(GPUgetCmdBuffer),
 };
 
 static const struct sym cdr_syms[] = {
@@ -11,6 +11,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 
+#include <libpcsxcore/lightrec/plugin.h>
 #include <libpcsxcore/misc.h>
 #include <libpcsxcore/plugins.h>
 #include <libpcsxcore/psxcommon.h>
@@ -212,11 +213,81 @@ int chmod(const char *pathname, mode_t mode)
 	return 0;
 }
 
+#define SH4_CCR		((volatile uint32_t *)0xff00001c)
+#define SH4_CCR_ICI	(1 << 11)
+
+#ifdef EMU_STATS
+static struct {
+	unsigned int calls, inv_all;
+	size_t bytes;
+} code_inv_stats;
+#endif
+
+static __attribute__((noinline)) void icache_inval_all_p2(void)
+{
+	*SH4_CCR |= SH4_CCR_ICI;
+
+	/* The CCR write needs 8 instructions to settle before we can return
+	 * to cached code. */
+	__asm__ volatile("nop\n\tnop\n\tnop\n\tnop\n\t"
+			 "nop\n\tnop\n\tnop\n\tnop\n\t");
+}
+
+void lightrec_code_inv_all(void)
+{
+	void (*p2_func)(void) = (void (*)(void))
+		(((uintptr_t)icache_inval_all_p2 & 0x1fffffff) | 0xa0000000);
+
+#ifdef EMU_STATS
+	code_inv_stats.inv_all++;
+#endif
+
+	p2_func();
+}
+
 void lightrec_code_inv(void *ptr, uint32_t len)
 {
 	void dcache_flush_range(uintptr_t start, size_t count);
 	void icache_flush_range(uintptr_t start, size_t count);
+	uintptr_t start = (uintptr_t)ptr & -32, end = (uintptr_t)ptr + len;
+
+#ifdef EMU_STATS
+	code_inv_stats.calls++;
+	code_inv_stats.bytes += len;
+#endif
+
+	dcache_flush_range((uintptr_t)ptr, len);
+
+	/* Freed code is only reused after lightrec_code_inv_all(), so stale
+	 * instruction cache lines can only be found where the new code shares
+	 * a line with a neighbouring block, or in the line after that one,
+	 * which may have been fetched ahead past the neighbour's last jump. */
+	if (end - start <= 96) {
+		icache_flush_range(start, end - start);
+	} else {
+		icache_flush_range(start, 64);
+		icache_flush_range((end - 1) & -32, 32);
+	}
+}
+
+#ifdef EMU_STATS
+static void emu_print_code_inv_stats(void)
+{
+	printf("Code inv: %u calls, %zu bytes, %u icache invalidations\n",
+	       code_inv_stats.calls, code_inv_stats.bytes,
+	       code_inv_stats.inv_all);
+
+	memset(&code_inv_stats, 0, sizeof(code_inv_stats));
+}
+
+/* Called about once per second; the counters cover the last 'frames' frames,
+ * rendered in 'ms' milliseconds */
+void emu_print_stats(unsigned int frames, unsigned int ms)
+{
+	printf("Stats for the last %u frames (%u ms):\n", frames, ms);
 
-	dcache_flush_range((uint32_t)ptr, len);
-	icache_flush_range((uint32_t)ptr, len);
+	emu_print_code_inv_stats();
+	lightrec_plugin_print_stats(frames, ms);
+	sioPrintStats();
 }
+#endif
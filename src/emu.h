@@ -25,5 +25,7 @@ void ide_shutdown(void);
 void sdcard_init(void);
 void sdcard_shutdown(void);
 
+void emu_print_stats(unsigned int frames, unsigned int ms);
+
 __END_DECLS
 #endif /* __BLOOM_EMU_H */
@@ -7,6 +7,7 @@
 
 extern "C" {
 #include <math.h>
+#include <sys/stat.h>
 }
 
 #include <tsu/genmenu.h>
@@ -18,6 +19,7 @@ extern "C" {
 #include <tsu/anims/alphafader.h>
 #include <tsu/triggers/death.h>
 
+#include <algorithm>
 #include <functional>
 #include <vector>
 
@@ -33,6 +35,10 @@ extern "C" {
 
 #define TOP_PATH "/"
 
+/* Directory entries read, and labels created, on each frame */
+#define SCAN_ENTRIES_PER_FRAME 64
+#define LABELS_PER_FRAME 32
+
 static std::shared_ptr<MyMenu> myMenu;
 
 MyLabel::MyLabel(std::shared_ptr<Font> fh, const std::string& text, int size,
@@ -97,7 +103,7 @@ void PathLabel::activate()
 
 	fs::path path = back ? pwd.parent_path() : pwd / name;
 
-	if (!back && fs::is_regular_file(path)) {
+	if (!back && m_is_file) {
 		if (emu_check_cd(path.c_str())) {
 			/* Launch ISO! */
 			myMenu->startExit();
@@ -135,6 +141,10 @@ MyMenu::MyMenu(std::shared_ptr<Font> fnt, const fs::path &path)
 
 	m_font = fnt;
 
+	m_listing = nullptr;
+	m_listed = 0;
+	m_scan_fd = -1;
+
 	populate_dft();
 }
 
@@ -155,6 +165,8 @@ void MyMenu::populate_dft()
 
 	std::shared_ptr<AnimFadeIn> anim;
 
+	stopScan();
+
 	m_entries.clear();
 	m_scene->animRemoveAll();
 	m_scene->subRemoveAll();
@@ -193,14 +205,46 @@ void MyMenu::populate_dft()
 	m_cursel = 0;
 }
 
+static bool dir_entry_listed(const fs::path &path, const DirEntry &entry)
+{
+	if (entry.is_file) {
+		const std::string ext = fs::path(entry.name).extension();
+
+		return ext == ".iso"
+			|| ext == ".cue"
+			|| ext == ".ccd"
+			|| ext == ".exe"
+			|| ext == ".mds"
+			|| (WITH_CHD && ext == ".chd")
+			|| ext == ".pbp";
+	}
+
+	if (path == TOP_PATH) {
+		return entry.name == "cd"
+			|| entry.name == "pc"
+			|| entry.name == "ide"
+			|| entry.name == "sd";
+	}
+
+	return true;
+}
+
+/* Also true if both paths are equal */
+static bool path_is_parent(const fs::path &parent, const fs::path &path)
+{
+	return std::mismatch(parent.begin(), parent.end(),
+			     path.begin(), path.end()).first == parent.end();
+}
+
 void MyMenu::populate(fs::path path, bool back)
 {
 	float dx = back ? 1.0f : -1.0f;
 	std::shared_ptr<AnimFadeIn> anim;
-	dirent_t *d;
-	bool is_file;
+	struct stat st;
 	int fd;
 
+	stopScan();
+
 	m_font_size = ENTRY_SIZE;
 
 	m_entries.clear();
@@ -215,35 +259,33 @@ void MyMenu::populate(fs::path path, bool back)
 		fd = fs_open(path.c_str(), O_DIR);
 	}
 
-	while ((d = fs_readdir(fd))) {
-		fs::path filepath = path / d->name;
-		is_file = fs::is_regular_file(filepath);
-
-		if (is_file) {
-			const std::string& ext = filepath.extension();
-
-			if (ext != ".iso"
-			    && ext != ".cue"
-			    && ext != ".ccd"
-			    && ext != ".exe"
-			    && ext != ".mds"
-			    && (!WITH_CHD || ext != ".chd")
-			    && ext != ".pbp") {
-				continue;
-			}
-		} else if (path == TOP_PATH) {
-			std::string name = d->name;
-
-			if (name != "cd"
-			    && name != "pc"
-			    && name != "ide"
-			    && name != "sd") {
-				continue;
-			}
-		}
+	/* A directory without a modification time can't be revalidated, so
+	 * it will be scanned every time. */
+	if (fs_stat(path.c_str(), &st, 0))
+		st.st_mtime = 0;
+
+	/* Only keep the listings of this directory and of its parents, which
+	 * are the ones going back will show; large directories elsewhere in
+	 * the tree would otherwise stay in memory forever. */
+	for (auto it = m_dir_cache.begin(); it != m_dir_cache.end(); ) {
+		if (path_is_parent(it->first, path))
+			it++;
+		else
+			it = m_dir_cache.erase(it);
+	}
+
+	m_listing = &m_dir_cache[path.string()];
+	m_listed = 0;
 
-		addEntry(std::make_shared<PathLabel>(m_font, d->name,
-						     is_file, m_font_size));
+	if (st.st_mtime && m_listing->complete
+	    && m_listing->mtime == st.st_mtime) {
+		if (fd != -1)
+			fs_close(fd);
+	} else {
+		m_listing->mtime = st.st_mtime;
+		m_listing->complete = false;
+		m_listing->entries.clear();
+		m_scan_fd = fd;
 	}
 
 	anim = std::make_shared<AnimFadeIn>(false, MENU_OFF_X, [&] {
@@ -251,11 +293,68 @@ void MyMenu::populate(fs::path path, bool back)
 	});
 	m_scene->animRemoveAll();
 	m_scene->animAdd(anim);
-	fs_close(fd);
 
 	m_path = path;
 	m_cursel = 0;
 	m_input_allowed = true;
+
+	scanDir();
+}
+
+void MyMenu::scanDir()
+{
+	unsigned int i;
+	dirent_t *d;
+
+	if (!m_listing)
+		return;
+
+	for (i = 0; m_scan_fd != -1 && i < SCAN_ENTRIES_PER_FRAME; i++) {
+		d = fs_readdir(m_scan_fd);
+		if (!d) {
+			fs_close(m_scan_fd);
+			m_scan_fd = -1;
+			m_listing->complete = true;
+			break;
+		}
+
+		/* Use the entry type returned by readdir() instead of doing
+		 * a stat() for each entry. The top directory only contains
+		 * mount points. */
+		DirEntry entry = {
+			d->name, m_path != TOP_PATH && !(d->attr & O_DIR),
+		};
+
+		if (dir_entry_listed(m_path, entry))
+			m_listing->entries.push_back(entry);
+	}
+
+	for (i = 0; m_listed < m_listing->entries.size()
+	     && i < LABELS_PER_FRAME; i++, m_listed++) {
+		const DirEntry &entry = m_listing->entries[m_listed];
+
+		addEntry(std::make_shared<PathLabel>(m_font, entry.name,
+						     entry.is_file, m_font_size));
+	}
+}
+
+void MyMenu::stopScan()
+{
+	/* An interrupted scan leaves an incomplete listing in the cache, which
+	 * will be scanned again on the next visit. */
+	if (m_scan_fd != -1) {
+		fs_close(m_scan_fd);
+		m_scan_fd = -1;
+	}
+
+	m_listing = nullptr;
+}
+
+void MyMenu::controlPerFrame()
+{
+	GenericMenu::controlPerFrame();
+
+	scanDir();
 }
 
 void MyMenu::preparePopulate(fs::path path, bool back, bool dft)
@@ -271,6 +370,8 @@ void MyMenu::preparePopulate(fs::path path, bool back, bool dft)
 				populate(path, back);
 		});
 
+		stopScan();
+
 		m_scene->animRemoveAll();
 		m_scene->animAdd(anim);
 		m_input_allowed = false;
@@ -338,6 +439,8 @@ void MyMenu::inputEvent(const Event & evt) {
 }
 
 void MyMenu::startExit() {
+	stopScan();
+
 	// Apply some expmovers to the options.
 
 	for (unsigned int i = 0; i < m_entries.size(); i++) {
@@ -13,8 +13,10 @@
 
 #include <functional>
 #include <filesystem>
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -58,7 +60,8 @@ public:
 	PathLabel(std::shared_ptr<Font> fh, const std::string& text, bool is_file, int size)
 		: MyLabel(fh, text, size,
 			  is_file ? Color(1.0f, 0.7f, 0.7f, 1.0f) : Color(1.0f, 1.0f, 1.0f, 1.0f),
-			  is_file ? Color(1.0f, 0.3f, 0.3f, 1.0f) : Color(1.0f, 0.7f, 0.7f, 0.7f))
+			  is_file ? Color(1.0f, 0.3f, 0.3f, 1.0f) : Color(1.0f, 0.7f, 0.7f, 0.7f)),
+		m_is_file(is_file)
 	{
 	}
 
@@ -66,6 +69,9 @@ public:
 
 	virtual void activate();
 	virtual void cancel();
+
+private:
+	bool m_is_file;
 };
 
 class MainMenuLabel : public MyLabel {
@@ -98,6 +104,17 @@ private:
 	Action m_action;
 };
 
+struct DirEntry {
+	std::string name;
+	bool is_file;
+};
+
+struct DirListing {
+	time_t mtime;
+	bool complete;
+	std::vector<DirEntry> entries;
+};
+
 class MyMenu : public GenericMenu {
 public:
 	MyMenu(std::shared_ptr<Font> fnt, const fs::path &path);
@@ -119,7 +136,13 @@ public:
 
 	virtual void startExit();
 
+protected:
+	virtual void controlPerFrame();
+
 private:
+	void scanDir();
+	void stopScan();
+
 	bool m_input_allowed;
 	Color m_color0, m_color1;
 	std::vector<std::shared_ptr<MyLabel> > m_entries;
@@ -127,6 +150,12 @@ private:
 	unsigned int m_cursel;
 	unsigned int m_font_size;
 	std::shared_ptr<Font> m_font;
+
+	/* Listings of the current directory and of its parents */
+	std::map<std::string, DirListing> m_dir_cache;
+	DirListing *m_listing;
+	unsigned int m_listed;
+	int m_scan_fd;
 };
 
 
@@ -293,6 +293,10 @@ static void dc_vout_flip(const void *vram, int stride, int bgr24,
 		vmu_printf("\n FPS: %5.1f\n\n %ux%u-%u", (float)frames,
 			   screen_w, screen_h, screen_bpp);
 
+#ifdef EMU_STATS
+		emu_print_stats(frames, new_timer - timer_ms);
+#endif
+
 		timer_ms = new_timer;
 		frames = 0;
 	}
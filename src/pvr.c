@@ -10,6 +10,7 @@
 #include <gpulib/gpu_timing.h>
 
 #include <alloca.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -43,6 +44,17 @@
 
 #define pvr_printf(...) do { if (DEBUG) printf(__VA_ARGS__); } while (0)
 
+#ifdef EMU_STATS
+#define STATS 1
+#else
+#define STATS 0
+#endif
+
+#define stats_printf(...) do { if (STATS) printf(__VA_ARGS__); } while (0)
+
+#define pvr_stats_add(field, val) \
+	do { if (STATS) pvr.stats.field += (val); } while (0)
+
 #define container_of(ptr, type, member) \
 	((type *)((void *)(ptr) - offsetof(type, member)))
 
@@ -59,6 +71,27 @@
 #define FILTER_MODE (WITH_BILINEAR ? PVR_FILTER_BILINEAR : PVR_FILTER_NONE)
 
 #define CLUT_IS_MASK BIT(15)
+#define CLUT_IS_BRIGHT BIT(16)
+
+#define NB_RENDER_TARGETS 4
+
+/* Framebuffer write settings (PVR_FB_CFG_2) used for render targets: ARGB1555
+ * output, with bit 15 set for pixels of alpha 0x80 and above. */
+#define FB_CFG_PACKMODE_MASK 0x00ff0007
+#define FB_CFG_RENDER_TARGET (0x3 | (0x80 << 16))
+
+/* Texture pages are split in horizontal bands of 16 lines, which are
+ * individually tracked for VRAM writes and checksummed. */
+#define TEXTURE_BAND_SHIFT 4
+#define TEXTURE_BAND_HEIGHT (1 << TEXTURE_BAND_SHIFT)
+#define NB_TEXTURE_BANDS (256 / TEXTURE_BAND_HEIGHT)
+
+/* Alpha class of a converted texture, computed when its texels (or palette)
+ * are loaded. A texture without any flag set is fully opaque; one with only
+ * transparent (0x0000) texels needs the punch-through list; one with texels
+ * that have the semi-transparency bit set is truly translucent. */
+#define TEXTURE_ALPHA_PUNCH_THROUGH BIT(0)
+#define TEXTURE_ALPHA_TRANSLUCENT BIT(1)
 
 union PacketBuffer {
 	uint32_t U4[16];
@@ -106,6 +139,10 @@ struct texture_settings {
 struct texture_page {
 	struct texture_page *next;
 	struct texture_settings settings;
+	unsigned int frame;
+	uint16_t dirty;
+	uint8_t alpha;
+	uint32_t checksum[NB_TEXTURE_BANDS];
 	union {
 		pvr_ptr_t tex;
 		struct texture_vq *vq;
@@ -117,16 +154,34 @@ struct texture_page_16bpp {
 	pvr_ptr_t mask_tex;
 };
 
+struct texture_clut {
+	uint32_t clut;
+	bool stale;
+	uint8_t alpha;
+	unsigned int frame;
+	uint32_t sat_mask;
+	uint32_t checksum;
+};
+
 struct texture_page_8bpp {
 	struct texture_page base;
 	unsigned int nb_cluts;
-	uint16_t clut[NB_CODEBOOKS_8BPP];
+	struct texture_clut clut[NB_CODEBOOKS_8BPP];
 };
 
 struct texture_page_4bpp {
 	struct texture_page base;
 	unsigned int nb_cluts;
-	uint16_t clut[NB_CODEBOOKS_4BPP];
+	struct texture_clut clut[NB_CODEBOOKS_4BPP];
+};
+
+struct render_target {
+	pvr_ptr_t tex;
+	pvr_ptr_t seed;
+	unsigned int frame;
+	uint16_t x, y, w, h;
+	uint16_t tex_w, tex_h;
+	bool valid;
 };
 
 enum blending_mode {
@@ -137,11 +192,32 @@ enum blending_mode {
 	BLENDING_MODE_NONE,
 };
 
+struct pvr_stats {
+	unsigned int pages_invalidated;
+	unsigned int pages_converted;
+	unsigned int pages_kept;
+	unsigned int pages_patched;
+	unsigned int cluts_invalidated;
+	unsigned int bytes_converted;
+	unsigned int bytes_patched;
+	unsigned int rt_created;
+	unsigned int rt_reused;
+	unsigned int rt_evicted;
+	unsigned int prims[PVR_LIST_PT_POLY + 1];
+	unsigned int sprites;
+	unsigned int ta_bytes;
+	unsigned int bright_single_pass;
+	unsigned int bright_two_pass;
+	unsigned int op_list_full;
+};
+
 struct pvr_renderer {
 	uint32_t gp1;
 
+	unsigned int frame;
 	unsigned int zoffset;
 	uint32_t dr_state;
+	unsigned int op_bytes;
 
 	uint16_t draw_x1;
 	uint16_t draw_y1;
@@ -151,13 +227,22 @@ struct pvr_renderer {
 	int16_t draw_dx;
 	int16_t draw_dy;
 
+	/* Current and previous scanout positions */
+	uint16_t src_x;
+	uint16_t src_y;
+	uint16_t prev_src_x;
+	uint16_t prev_src_y;
+
 	uint32_t new_frame :1;
+	uint32_t draw_area_changed :1;
 
 	uint32_t set_mask :1;
 	uint32_t check_mask :1;
 
 	uint32_t depthcmp :3;
 
+	uint32_t fb_rt :1;
+
 	uint32_t list :3;
 	uint32_t start_list :3;
 
@@ -169,15 +254,30 @@ struct pvr_renderer {
 
 	struct texture_page *textures[32];
 	struct texture_page *reap_list[2];
+
+	/* VRAM lines that hold a palette loaded in a codebook */
+	uint32_t clut_lines[FRAME_HEIGHT / 32];
+
+	struct render_target render_targets[NB_RENDER_TARGETS];
+	struct render_target *rt;
+	uint32_t fb_cfg;
+
+	struct pvr_stats stats;
 };
 
 /* Forward declarations */
 static void adjust_vcoords(float *vcoords, unsigned int nb,
 			   enum texture_bpp bpp, unsigned int codebook);
+static void draw_prim(pvr_poly_cxt_t *cxt,
+		      const float *x, const float *y,
+		      const float *u, const float *v,
+		      const uint32_t *color, unsigned int nb,
+		      uint32_t oargb);
 
 static struct pvr_renderer pvr;
 
 alignas(32) static unsigned char vertbuf[0x20000];
+alignas(32) static unsigned char op_vertbuf[0x10000];
 
 int renderer_init(void)
 {
@@ -240,10 +340,34 @@ static void pvr_reap_textures(void)
 	pvr.reap_list[0] = NULL;
 }
 
+static void pvr_reap_texture(struct texture_page *page)
+{
+	page->next = pvr.reap_list[0];
+	pvr.reap_list[0] = page;
+}
+
+static void pvr_free_render_target(struct render_target *rt)
+{
+	if (rt->tex) {
+		pvr_mem_free(rt->tex);
+		pvr_mem_free(rt->seed);
+		rt->tex = NULL;
+		rt->seed = NULL;
+	}
+
+	rt->valid = false;
+}
+
 void renderer_finish(void)
 {
+	unsigned int i;
+
 	pvr_reap_textures();
 	pvr_reap_textures();
+
+	for (i = 0; i < NB_RENDER_TARGETS; i++)
+		pvr_free_render_target(&pvr.render_targets[i]);
+
 	free(gpu.vram);
 }
 
@@ -254,6 +378,14 @@ static inline uint16_t bgr_to_rgb(uint16_t bgr)
 		| (bgr & 0x83e0);
 }
 
+static inline uint16_t rgb_double(uint16_t rgb)
+{
+	uint16_t sat = (rgb & 0x4210) >> 4;
+
+	/* Double each 5-bit component, saturating to 0x1f */
+	return ((rgb & 0x3def) << 1) | (sat * 0x1f) | (rgb & 0x8000);
+}
+
 static inline uint32_t min32(uint32_t a, uint32_t b)
 {
 	return a < b ? a : b;
@@ -274,13 +406,67 @@ static inline uint16_t *clut_get_ptr(uint16_t clut)
 	return &gpu.vram[clut_get_offset(clut) / 2];
 }
 
-static void load_palette(pvr_ptr_t palette_addr, uint16_t clut, unsigned int nb)
+#define XXH_PRIME32_1 0x9e3779b1u
+#define XXH_PRIME32_2 0x85ebca77u
+#define XXH_PRIME32_3 0xc2b2ae3du
+
+static inline uint32_t rotl32(uint32_t val, unsigned int shift)
+{
+	return (val << shift) | (val >> (32 - shift));
+}
+
+static inline uint32_t xxh32_round(uint32_t acc, uint32_t input)
+{
+	return rotl32(acc + input * XXH_PRIME32_2, 13) * XXH_PRIME32_1;
+}
+
+static uint32_t vram_checksum(const uint16_t *src,
+			      unsigned int w, unsigned int h)
+{
+	uint32_t v1 = XXH_PRIME32_1 + XXH_PRIME32_2, v2 = XXH_PRIME32_2;
+	uint32_t v3 = 0, v4 = -XXH_PRIME32_1;
+	const uint32_t *src32;
+	unsigned int x, y;
+	uint32_t hash;
+
+	/* XXH32 of the lines put end to end. A false match would keep a stale
+	 * texture around, so a plain sum is not good enough. The width is a
+	 * multiple of 8 pixels (16 bytes), which is all XXH32 processes at
+	 * once, so there is no tail to handle. */
+	for (y = 0; y < h; y++) {
+		src32 = (const uint32_t *)src;
+
+		for (x = 0; x < w / 2; x += 4) {
+			v1 = xxh32_round(v1, src32[x + 0]);
+			v2 = xxh32_round(v2, src32[x + 1]);
+			v3 = xxh32_round(v3, src32[x + 2]);
+			v4 = xxh32_round(v4, src32[x + 3]);
+		}
+
+		src += 1024;
+	}
+
+	hash = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+	hash += w * h * 2;
+
+	hash ^= hash >> 15;
+	hash *= XXH_PRIME32_2;
+	hash ^= hash >> 13;
+	hash *= XXH_PRIME32_3;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+static uint8_t load_palette(pvr_ptr_t palette_addr, uint32_t clut,
+			    unsigned int nb, uint32_t *sat_mask)
 {
 	alignas(32) uint64_t palette_data[256];
-	uint16_t pixel;
+	uint16_t pixel, sat = 0;
 	uint64_t color;
 	uint16_t *palette;
 	unsigned int i;
+	uint8_t alpha = 0;
 
 	palette = clut_get_ptr(clut);
 
@@ -295,6 +481,11 @@ static void load_palette(pvr_ptr_t palette_addr, uint16_t clut, unsigned int nb)
 		 * semi-transparent or not. */
 		if (pixel != 0x0000) {
 			color = bgr_to_rgb(pixel);
+			sat |= color;
+
+			if (clut & CLUT_IS_BRIGHT)
+				color = rgb_double(color);
+
 			color |= color << 16;
 			color |= color << 32;
 
@@ -302,65 +493,101 @@ static void load_palette(pvr_ptr_t palette_addr, uint16_t clut, unsigned int nb)
 				palette_data[i] = color ^ 0x8000800080008000ull;
 			else
 				palette_data[i] = color | 0x8000800080008000ull;
+
+			if (pixel & 0x8000)
+				alpha |= TEXTURE_ALPHA_TRANSLUCENT;
 		} else {
 			palette_data[i] = 0;
+			alpha |= TEXTURE_ALPHA_PUNCH_THROUGH;
 		}
 	}
 
 	pvr_txr_load(palette_data, palette_addr, nb * sizeof(color));
+
+	/* Components that have texels of 0x10 or above saturate when the
+	 * palette is doubled. Report them as RGB888 vertex color masks. */
+	*sat_mask = ((sat & 0x4000) ? 0xff0000 : 0)
+		| ((sat & 0x0200) ? 0x00ff00 : 0)
+		| ((sat & 0x0010) ? 0x0000ff : 0);
+
+	return alpha;
 }
 
-static void
-load_palette_bpp4(struct texture_page *page, unsigned int offset, uint16_t clut)
+static uint8_t
+load_palette_bpp4(struct texture_page *page, unsigned int offset,
+		  uint32_t clut, uint32_t *sat_mask)
 {
 	struct pvr_vq_codebook_4bpp *codebook4 = &page->vq->codebook4[offset];
 
-	load_palette(codebook4->palette, clut, 16);
+	return load_palette(codebook4->palette, clut, 16, sat_mask);
 }
 
-static void
-load_palette_bpp8(struct texture_page *page, unsigned int offset, uint16_t clut)
+static uint8_t
+load_palette_bpp8(struct texture_page *page, unsigned int offset,
+		  uint32_t clut, uint32_t *sat_mask)
 {
 	struct pvr_vq_codebook_8bpp *codebook8 = &page->vq->codebook8[offset];
 
-	load_palette(codebook8->palette, clut, 256);
+	return load_palette(codebook8->palette, clut, 256, sat_mask);
 }
 
 static unsigned int
-find_texture_codebook(struct texture_page *page, uint16_t clut)
+find_texture_codebook(struct texture_page *page, uint32_t clut)
 {
 	struct texture_page_4bpp *page4 = to_texture_page_4bpp(page);
 	bool bpp4 = page->settings.bpp == TEXTURE_4BPP;
 	unsigned int codebooks = bpp4 ? NB_CODEBOOKS_4BPP : NB_CODEBOOKS_8BPP;
-	unsigned int i;
+	unsigned int i, cy;
 
 	for (i = 0; i < page4->nb_cluts; i++) {
-		if (page4->clut[i] == clut)
+		if (page4->clut[i].clut == clut && !page4->clut[i].stale)
 			break;
 	}
 
 	if (i < page4->nb_cluts) {
-		pvr_printf("Found %s CLUT at offset %u\n",
+		pvr_printf("Found %s%s CLUT at offset %u\n",
+			   (clut & CLUT_IS_BRIGHT) ? "bright " : "",
 			   (clut & CLUT_IS_MASK) ? "mask" : "normal", i);
+		page4->clut[i].frame = pvr.frame;
 		return i;
 	}
 
+	/* Reclaim a stale codebook, once the frames that may sample it have
+	 * been rendered. */
+	for (i = 0; i < page4->nb_cluts; i++) {
+		if (page4->clut[i].stale && pvr.frame - page4->clut[i].frame >= 2)
+			break;
+	}
+
 	if (i == codebooks) {
 		/* No space? Let's trash everything and start again */
 		i = 0;
+		page4->nb_cluts = 0;
 		memset(page4->clut, 0, codebooks * sizeof(*page4->clut));
 	}
 
 	/* We didn't find the CLUT anywere - add it and load the palette */
-	page4->clut[i] = clut;
-	page4->nb_cluts = i + 1;
-
-	pvr_printf("Load CLUT 0x%04hx at offset %u\n", clut, i);
-
-	if (bpp4)
-		load_palette_bpp4(page, i, clut);
-	else
-		load_palette_bpp8(page, i, clut);
+	page4->clut[i].clut = clut;
+	page4->clut[i].stale = false;
+	page4->clut[i].frame = pvr.frame;
+	page4->clut[i].checksum = vram_checksum(clut_get_ptr(clut),
+						bpp4 ? 16 : 256, 1);
+	page4->nb_cluts = max32(page4->nb_cluts, i + 1);
+
+	cy = (clut >> 6) & 0x1ff;
+	pvr.clut_lines[cy / 32] |= BIT(cy % 32);
+
+	pvr_printf("Load CLUT 0x%05" PRIx32 " at offset %u\n", clut, i);
+
+	/* Paletted pages are classified by their palette, which is
+	 * conservative as not all of its colors may be used. */
+	if (bpp4) {
+		page4->clut[i].alpha = load_palette_bpp4(page, i, clut,
+							 &page4->clut[i].sat_mask);
+	} else {
+		page4->clut[i].alpha = load_palette_bpp8(page, i, clut,
+							 &page4->clut[i].sat_mask);
+	}
 
 	return i;
 }
@@ -440,58 +667,87 @@ static struct texture_page * alloc_texture(struct texture_settings settings)
 	return alloc_texture_4bpp();
 }
 
+/* The load_texture_*() functions convert the (x, y, w, h) area of the texture
+ * page pointed by src, with x/w in 16-bit VRAM pixels. The area must be
+ * aligned to 16 pixels horizontally. */
+
 static void load_texture_16bpp(struct texture_page_16bpp *page,
-			       const uint16_t *src)
+			       const uint16_t *src, unsigned int x,
+			       unsigned int y, unsigned int w, unsigned int h)
 {
 	alignas(32) uint16_t mask_line[256];
-	uint16_t *mask, *dst;
-	unsigned int x, y;
+	uint16_t *mask, *dst, px, stp = 0;
+	bool transparent = false;
+	unsigned int i;
 
-	dst = (uint16_t *)page->base.tex;
-	mask = (uint16_t *)page->mask_tex;
+	dst = (uint16_t *)page->base.tex + y * 256 + x;
+	mask = (uint16_t *)page->mask_tex + y * 256 + x;
+	src += y * 1024 + x;
 
-	for (y = 0; y < 256; y++) {
-		pvr_txr_load(src, dst, 512);
+	for (; h; h--) {
+		pvr_txr_load(src, dst, w * 2);
 
-		for (x = 0; x < 256; x++)
-			mask_line[x] = src[x] ? src[x] ^ 0x8000 : 0;
+		for (i = 0; i < w; i++) {
+			px = src[i];
+			mask_line[i] = px ? px ^ 0x8000 : 0;
 
-		pvr_txr_load(mask_line, mask, sizeof(mask_line));
+			stp |= px;
+			transparent |= !px;
+		}
+
+		pvr_txr_load(mask_line, mask, w * 2);
 
 		dst += 256;
+		mask += 256;
 		src += 1024;
 	}
+
+	/* Patched areas can only add to the alpha class of the page */
+	if (transparent)
+		page->base.alpha |= TEXTURE_ALPHA_PUNCH_THROUGH;
+	if (stp & 0x8000)
+		page->base.alpha |= TEXTURE_ALPHA_TRANSLUCENT;
 }
 
-static void load_texture_8bpp(struct texture_page *page, const uint8_t *src)
+static void load_texture_8bpp(struct texture_page *page, const uint16_t *src,
+			      unsigned int x, unsigned int y,
+			      unsigned int w, unsigned int h)
 {
-	uint8_t *dst = page->vq->frame;
-	unsigned int y;
+	uint8_t *dst = page->vq->frame + y * 256 + x * 2;
+
+	src += y * 1024 + x;
 
-	for (y = 0; y < 256; y++) {
-		pvr_txr_load(src, dst, 256);
-		src += 2048;
+	for (; h; h--) {
+		pvr_txr_load(src, dst, w * 2);
+		src += 1024;
 		dst += 256;
 	}
 }
 
-static void load_texture_4bpp(struct texture_page *page, const uint8_t *src)
+static void load_texture_4bpp(struct texture_page *page, const uint16_t *src,
+			      unsigned int x, unsigned int y,
+			      unsigned int w, unsigned int h)
 {
-	uint8_t *dst = page->vq->frame;
+	uint8_t *dst = page->vq->frame + y * 256 + x * 4;
 	alignas(32) uint8_t line[256];
-	unsigned int x, y;
+	const uint8_t *src8;
+	unsigned int i;
 	uint8_t px;
 
-	for (y = 0; y < 256; y++) {
-		for (x = 0; x < 256; x += 2) {
-			px = src[x / 2];
-			line[x + 0] = px & 0xf;
-			line[x + 1] = px >> 4;
+	src += y * 1024 + x;
+
+	for (; h; h--) {
+		src8 = (const uint8_t *)src;
+
+		for (i = 0; i < w * 4; i += 2) {
+			px = src8[i / 2];
+			line[i + 0] = px & 0xf;
+			line[i + 1] = px >> 4;
 		}
 
-		pvr_txr_load(line, dst, sizeof(line));
+		pvr_txr_load(line, dst, w * 4);
 
-		src += 2048;
+		src += 1024;
 		dst += 256;
 	}
 }
@@ -503,33 +759,123 @@ static const uint16_t * texture_page_get_addr(unsigned int page_offset)
 	return &gpu.vram[page_x * 64 + page_y * 256 * 1024];
 }
 
-static void load_texture(struct texture_page *page,
-			 unsigned int page_offset)
+static inline unsigned int texture_page_width(enum texture_bpp bpp)
+{
+	/* Width of the texture page's footprint in VRAM, in 16-bit pixels */
+	return 64 << bpp;
+}
+
+static uint32_t texture_band_checksum(const struct texture_page *page,
+				      unsigned int page_offset,
+				      unsigned int band)
 {
-	const void *src = texture_page_get_addr(page_offset);
+	const uint16_t *src = texture_page_get_addr(page_offset);
+
+	return vram_checksum(&src[band * TEXTURE_BAND_HEIGHT * 1024],
+			     texture_page_width(page->settings.bpp),
+			     TEXTURE_BAND_HEIGHT);
+}
+
+static void load_texture_rect(struct texture_page *page,
+			      unsigned int page_offset,
+			      unsigned int x, unsigned int y,
+			      unsigned int w, unsigned int h)
+{
+	const uint16_t *src = texture_page_get_addr(page_offset);
 
 	if (page->settings.bpp == TEXTURE_16BPP)
-		load_texture_16bpp(to_texture_page_16bpp(page), src);
+		load_texture_16bpp(to_texture_page_16bpp(page), src, x, y, w, h);
 	else if (page->settings.bpp == TEXTURE_8BPP)
-		load_texture_8bpp(page, src);
+		load_texture_8bpp(page, src, x, y, w, h);
 	else
-		load_texture_4bpp(page, src);
+		load_texture_4bpp(page, src, x, y, w, h);
+}
+
+static void load_texture(struct texture_page *page,
+			 unsigned int page_offset)
+{
+	unsigned int band;
+
+	page->alpha = 0;
+
+	load_texture_rect(page, page_offset, 0, 0,
+			  texture_page_width(page->settings.bpp), 256);
+
+	for (band = 0; band < NB_TEXTURE_BANDS; band++)
+		page->checksum[band] = texture_band_checksum(page, page_offset, band);
+
+	page->dirty = 0;
+	pvr_stats_add(pages_converted, 1);
+	pvr_stats_add(bytes_converted, texture_page_width(page->settings.bpp) * 256 * 2);
+}
+
+static bool texture_page_verify(struct texture_page *page,
+				unsigned int page_offset, uint16_t bands)
+{
+	unsigned int band;
+
+	for (band = 0; band < NB_TEXTURE_BANDS; band++) {
+		if ((bands & BIT(band))
+		    && page->checksum[band] != texture_band_checksum(page, page_offset, band))
+			return false;
+	}
+
+	/* The texels we are about to sample did not change - keep using the
+	 * converted texture. */
+	page->dirty &= ~bands;
+	pvr_stats_add(pages_kept, 1);
+
+	return true;
+}
+
+static uint16_t texture_get_bands(struct texture_settings settings,
+				  unsigned int vmin, unsigned int vmax)
+{
+	unsigned int first, last;
+
+	/* With a texture window, or if the V coordinates wrap around, any
+	 * line of the texture page may be sampled. */
+	if (settings.mask_y || vmax > 255)
+		return 0xffff;
+
+	if (WITH_BILINEAR) {
+		/* Bilinear filtering samples the neighbouring lines */
+		vmin = vmin ? vmin - 1 : 0;
+		vmax = vmax < 255 ? vmax + 1 : 255;
+	}
+
+	first = vmin >> TEXTURE_BAND_SHIFT;
+	last = vmax >> TEXTURE_BAND_SHIFT;
+
+	return (uint16_t)((BIT(last + 1) - 1) & ~(BIT(first) - 1));
 }
 
 static struct texture_page *
 get_or_alloc_texture(unsigned int page_x, unsigned int page_y,
 		     uint16_t clut, struct texture_settings settings,
-		     unsigned int *codebook)
+		     uint16_t bands, unsigned int *codebook)
 {
 	unsigned int page_offset = page_y * 16 + page_x;
-	struct texture_page *page;
+	struct texture_page *page, **prev;
 
-	for (page = pvr.textures[page_offset]; page; page = page->next) {
+	for (prev = &pvr.textures[page_offset]; *prev; prev = &(*prev)->next) {
 		/* The page settings (window mask/offset and bpp) must match. */
-		if (!memcmp(&page->settings, &settings, sizeof(settings)))
+		if (!memcmp(&(*prev)->settings, &settings, sizeof(settings)))
 			break;
 	}
 
+	page = *prev;
+
+	if (page && (page->dirty & bands)
+	    && !texture_page_verify(page, page_offset, page->dirty & bands)) {
+		pvr_printf("Texels of page %u changed, reloading\n", page_offset);
+
+		/* Drop the stale texture, a new one will be created below */
+		*prev = page->next;
+		pvr_reap_texture(page);
+		page = NULL;
+	}
+
 	if (!page) {
 		pvr_printf("Creating new %ubpp texture for page %u\n",
 			   4 << settings.bpp, page_offset);
@@ -548,18 +894,14 @@ get_or_alloc_texture(unsigned int page_x, unsigned int page_y,
 		load_texture(page, page_offset);
 	}
 
+	page->frame = pvr.frame;
+
 	if (settings.bpp != TEXTURE_16BPP)
 		*codebook = find_texture_codebook(page, clut);
 
 	return page;
 }
 
-static void pvr_reap_texture(struct texture_page *page)
-{
-	page->next = pvr.reap_list[0];
-	pvr.reap_list[0] = page;
-}
-
 static void invalidate_textures(unsigned int page_offset)
 {
 	struct texture_page *page, *next;
@@ -579,39 +921,231 @@ void invalidate_all_textures(void)
 	for (i = 0; i < 32; i++)
 		invalidate_textures(i);
 
+	memset(pvr.clut_lines, 0, sizeof(pvr.clut_lines));
+
 	pvr_reap_textures();
 
 	pvr_wait_render_done();
 	pvr_reap_textures();
 }
 
-void renderer_update_caches(int x, int y, int w, int h, int state_changed)
+static uint16_t rect_get_bands(unsigned int x, unsigned int y,
+			       unsigned int x2, unsigned int y2,
+			       unsigned int px, unsigned int py,
+			       unsigned int px2, unsigned int py2)
+{
+	unsigned int first, last;
+
+	if (x >= px2 || x2 <= px || y >= py2 || y2 <= py)
+		return 0;
+
+	first = (max32(y, py) - py) >> TEXTURE_BAND_SHIFT;
+	last = (min32(y2, py2) - 1 - py) >> TEXTURE_BAND_SHIFT;
+
+	return (uint16_t)((BIT(last + 1) - 1) & ~(BIT(first) - 1));
+}
+
+static uint16_t texture_page_written_bands(unsigned int page_offset,
+					   enum texture_bpp bpp,
+					   unsigned int x, unsigned int y,
+					   unsigned int x2, unsigned int y2)
+{
+	unsigned int px = (page_offset & 0xf) * 64, py = (page_offset / 16) * 256;
+	unsigned int px2 = px + texture_page_width(bpp);
+	uint16_t bands;
+
+	bands = rect_get_bands(x, y, x2, y2, px, py,
+			       min32(px2, FRAME_WIDTH), py + 256);
+
+	if (px2 > FRAME_WIDTH) {
+		/* The page's lines overflow into the start of the next VRAM
+		 * lines, so writing to line N there modifies line N-1 of the
+		 * texture page. */
+		bands |= rect_get_bands(x, y, x2, y2, 0, py + 1,
+					px2 - FRAME_WIDTH, py + 257);
+	}
+
+	return bands;
+}
+
+static void texture_page_invalidate_cluts(struct texture_page *page,
+					  unsigned int x, unsigned int y,
+					  unsigned int x2, unsigned int y2)
 {
-	unsigned int x2, y2, dx, dy, page_offset;
+	struct texture_page_4bpp *page4 = to_texture_page_4bpp(page);
+	unsigned int i, cx, cy, nb = page->settings.bpp == TEXTURE_4BPP ? 16 : 256;
+	struct texture_clut *entry;
 
-	/* Compute bottom-right point coordinates, aligned */
-	x2 = (unsigned int)((x + w + 63) & -64);
-	y2 = (unsigned int)((y + h + 255) & -256);
+	for (i = 0; i < page4->nb_cluts; i++) {
+		entry = &page4->clut[i];
+		cx = (entry->clut & 0x3f) * 16;
+		cy = (entry->clut >> 6) & 0x1ff;
+
+		if (entry->stale || cy < y || cy >= y2 || cx >= x2 || cx + nb <= x)
+			continue;
+
+		/* Palettes are tiny, so just check them right away. A stale
+		 * codebook is never used again; the palette will be loaded
+		 * into a new one, as the old one may still be in use by the
+		 * current frame. */
+		if (vram_checksum(clut_get_ptr(entry->clut), nb, 1) != entry->checksum) {
+			entry->stale = true;
+			pvr_stats_add(cluts_invalidated, 1);
+		}
+	}
+}
 
-	/* Align top-left point coordinates */
-	x &= -64;
-	y &= -256;
+static bool texture_page_in_flight(const struct texture_page *page)
+{
+	/* The page has been used by the frame being prepared, or by the
+	 * previous one which may still be rendering. */
+	return pvr.frame - page->frame < 2;
+}
 
-	/* Texture pages overlap, so we actually have to invalidate three
-	 * pages before the one pointed by the aligned x/y coordinates */
+static bool texture_page_patch(struct texture_page *page,
+			       unsigned int page_offset, uint16_t bands,
+			       unsigned int x, unsigned int y,
+			       unsigned int x2, unsigned int y2)
+{
+	unsigned int px = (page_offset & 0xf) * 64, py = (page_offset / 16) * 256;
+	unsigned int pw = texture_page_width(page->settings.bpp);
+	unsigned int band;
+
+	/* We can only modify the converted texture in place if it is not used
+	 * by the PVR, if the page's lines don't wrap around the VRAM, and if
+	 * the bands written were not already stale.
+	 * Pages still in flight are not double-buffered: they are only marked
+	 * dirty, and the written bands are converted again from the VRAM
+	 * mirror the next time they are sampled. Textures streamed every frame
+	 * therefore don't benefit from the early patching. */
+	if (texture_page_in_flight(page) || px + pw > FRAME_WIDTH
+	    || (page->dirty & bands))
+		return false;
+
+	/* Convert the written area, aligned to 16 pixels, straight from the
+	 * VRAM mirror into the texture. As gpulib reports VRAM writes every
+	 * few lines, the source data is usually still in the CPU cache. */
+	x = (max32(x, px) - px) & -16;
+	x2 = (min32(x2, px + pw) - px + 15) & -16;
+	y = max32(y, py) - py;
+	y2 = min32(y2, py + 256) - py;
+
+	load_texture_rect(page, page_offset, x, y, x2 - x, y2 - y);
+
+	for (band = 0; band < NB_TEXTURE_BANDS; band++) {
+		if (bands & BIT(band))
+			page->checksum[band] = texture_band_checksum(page, page_offset, band);
+	}
+
+	pvr_stats_add(pages_patched, 1);
+	pvr_stats_add(bytes_patched, (x2 - x) * (y2 - y) * 2);
+
+	return true;
+}
+
+static uint16_t rect_get_page_columns(unsigned int x, unsigned int x2)
+{
+	unsigned int first, last;
+	uint16_t columns;
+
+	/* Texture pages start every 64 pixels and are up to 256 pixels wide */
+	first = x < 192 ? 0 : (x - 192) / 64;
+	last = (x2 - 1) / 64;
+
+	columns = (uint16_t)((BIT(last + 1) - 1) & ~(BIT(first) - 1));
+
+	/* The lines of the last pages can wrap around to the start of the
+	 * next VRAM lines. */
 	if (x < 192)
-		x = 0;
-	else
-		x -= 192;
+		columns |= 0xe000;
+
+	return columns;
+}
+
+static bool rect_has_cluts(unsigned int y, unsigned int y2)
+{
+	unsigned int line;
 
-	for (dy = y; dy < y2; dy += 256) {
-		for (dx = x; dx < x2; dx += 64) {
-			page_offset = (dy >> 4) + (dx >> 6);
-			invalidate_textures(page_offset);
+	for (line = y; line < y2; line++) {
+		if (!(line % 32) && y2 - line >= 32) {
+			if (pvr.clut_lines[line / 32])
+				return true;
+
+			line += 31;
+		} else if (pvr.clut_lines[line / 32] & BIT(line % 32)) {
+			return true;
 		}
 	}
 
+	return false;
+}
+
+static void invalidate_rect(unsigned int x, unsigned int y,
+			    unsigned int w, unsigned int h)
+{
+	unsigned int i, page_offset, x2 = x + w, y2 = y + h;
+	struct texture_page *page;
+	struct render_target *rt;
+	uint16_t bands, columns;
+	bool cluts;
+
+	for (i = 0; i < NB_RENDER_TARGETS; i++) {
+		rt = &pvr.render_targets[i];
+
+		/* A write to the area of a render target means that the VRAM
+		 * mirror is now more up to date than the rendered texture,
+		 * unless it's the render target we're drawing to. */
+		if (rt->valid && rt != pvr.rt
+		    && x < rt->x + rt->w && x2 > rt->x
+		    && y < rt->y + rt->h && y2 > rt->y)
+			rt->valid = false;
+	}
+
+	/* Only visit the pages that may overlap the written area, unless the
+	 * write also hits a loaded palette. The second row of pages starts at
+	 * line 256, and the first one wraps down to it. */
+	columns = rect_get_page_columns(x, x2);
+	cluts = rect_has_cluts(y, y2);
+
+	for (page_offset = 0; page_offset < 32; page_offset++) {
+		if (!cluts && (!(columns & BIT(page_offset & 0xf))
+			       || (page_offset < 16 ? y > 256 : y2 <= 256)))
+			continue;
+
+		for (page = pvr.textures[page_offset]; page; page = page->next) {
+			bands = texture_page_written_bands(page_offset,
+							   page->settings.bpp,
+							   x, y, x2, y2);
+			if (bands && !texture_page_patch(page, page_offset, bands,
+							 x, y, x2, y2)) {
+				/* Only flag the written lines here. They will
+				 * be checked when they are sampled again. */
+				page->dirty |= bands;
+				pvr_stats_add(pages_invalidated, 1);
+			}
+
+			if (cluts && page->settings.bpp != TEXTURE_16BPP)
+				texture_page_invalidate_cluts(page, x, y, x2, y2);
+		}
+	}
+}
+
+void renderer_update_caches(int x, int y, int w, int h, int state_changed)
+{
 	pvr_printf("Update caches %dx%d -> %dx%d\n", x, y, x + w, y + h);
+
+	/* Split the rectangle if it wraps around the VRAM edges */
+	if (x + w > FRAME_WIDTH) {
+		renderer_update_caches(0, y, x + w - FRAME_WIDTH, h, state_changed);
+		w = FRAME_WIDTH - x;
+	}
+
+	if (y + h > FRAME_HEIGHT) {
+		renderer_update_caches(x, 0, w, y + h - FRAME_HEIGHT, state_changed);
+		h = FRAME_HEIGHT - y;
+	}
+
+	invalidate_rect(x, y, w, h);
 }
 
 void renderer_flush_queues(void)
@@ -628,6 +1162,12 @@ void renderer_notify_res_change(void)
 
 void renderer_notify_scanout_change(int x, int y)
 {
+	pvr.prev_src_x = pvr.src_x;
+	pvr.prev_src_y = pvr.src_y;
+	pvr.src_x = x;
+	pvr.src_y = y;
+
+	pvr.draw_area_changed = 1;
 }
 
 void renderer_notify_update_lace(int updated)
@@ -640,12 +1180,23 @@ void renderer_set_config(const struct rearmed_cbs *cbs)
 
 static inline float x_to_pvr(int16_t x)
 {
-	return (float)(x + pvr.draw_dx - pvr.draw_x1) * screen_fw;
+	/* Render targets are drawn at the native resolution */
+	return (float)(x + pvr.draw_dx - pvr.draw_x1) * (pvr.rt ? 1.0f : screen_fw);
 }
 
 static inline float y_to_pvr(int16_t y)
 {
-	return (float)(y + pvr.draw_dy - pvr.draw_y1) * screen_fh;
+	return (float)(y + pvr.draw_dy - pvr.draw_y1) * (pvr.rt ? 1.0f : screen_fh);
+}
+
+static inline float u_to_rt(const struct render_target *rt, unsigned int x)
+{
+	return (float)(x - rt->x) / (float)rt->tex_w;
+}
+
+static inline float v_to_rt(const struct render_target *rt, unsigned int y)
+{
+	return (float)(y - rt->y) / (float)rt->tex_h;
 }
 
 static inline float u_to_pvr(uint16_t u)
@@ -686,6 +1237,312 @@ static float get_zvalue(void)
 	return fint32.vf;
 }
 
+static void pvr_set_fb_format(bool rt)
+{
+	if (rt == pvr.fb_rt)
+		return;
+
+	/* The framebuffer write mode is global, and read when a render
+	 * starts. It is only changed when the scene is finished, as its render
+	 * cannot start before that, and once the render in progress (in the
+	 * other mode) is complete. The TA can then take the vertices of a
+	 * scene while the previous one is rendering. */
+	pvr_wait_render_done();
+
+	if (rt) {
+		pvr.fb_cfg = PVR_GET(PVR_FB_CFG_2);
+		PVR_SET(PVR_FB_CFG_2, (pvr.fb_cfg & ~FB_CFG_PACKMODE_MASK)
+			| FB_CFG_RENDER_TARGET);
+	} else {
+		PVR_SET(PVR_FB_CFG_2, pvr.fb_cfg);
+	}
+
+	pvr.fb_rt = rt;
+}
+
+static void pvr_begin_scene(struct render_target *rt)
+{
+	size_t rx, ry;
+
+	if (WITH_HYBRID_RENDERING) {
+		if (pvr.start_list == PVR_LIST_PT_POLY) {
+			pvr_set_vertbuf(PVR_LIST_TR_POLY,
+					vertbuf, sizeof(vertbuf));
+			pvr_set_vertbuf(PVR_LIST_OP_POLY,
+					op_vertbuf, sizeof(op_vertbuf));
+		} else {
+			pvr_set_vertbuf(PVR_LIST_TR_POLY, NULL, 0);
+			pvr_set_vertbuf(PVR_LIST_OP_POLY, NULL, 0);
+		}
+
+		pvr.op_bytes = 0;
+	}
+
+	if (rt) {
+		rx = rt->tex_w;
+		ry = rt->tex_h;
+		pvr_scene_begin_txr(rt->tex, &rx, &ry);
+	} else {
+		pvr_scene_begin();
+	}
+
+	pvr_list_begin(pvr.start_list);
+}
+
+static void pvr_finish_scene(bool rt)
+{
+	pvr_list_finish();
+
+	/* Render targets are rendered as ARGB1555, so that the pixels
+	 * which were not drawn (or were filled with 0x0000) keep bit 15
+	 * clear, and stay transparent when sampled as a PSX texture. */
+	pvr_set_fb_format(rt);
+	pvr_scene_finish();
+}
+
+static void pvr_end_render_target(void)
+{
+	pvr_finish_scene(true);
+
+	pvr.rt->valid = true;
+	pvr.rt = NULL;
+}
+
+static bool draw_area_overlaps_screen(unsigned int x, unsigned int y)
+{
+	return pvr.draw_x1 < x + gpu.screen.w
+		&& pvr.draw_y1 < y + gpu.screen.h
+		&& pvr.draw_x2 > x
+		&& pvr.draw_y2 > y;
+}
+
+static bool draw_area_on_screen(void)
+{
+	/* A double-buffered game draws the next frame to the buffer that was
+	 * displayed before the last flip. */
+	return draw_area_overlaps_screen(pvr.src_x, pvr.src_y)
+		|| draw_area_overlaps_screen(pvr.prev_src_x, pvr.prev_src_y);
+}
+
+static inline unsigned int next_pow2(unsigned int val)
+{
+	return 1u << (32 - __builtin_clz(val - 1));
+}
+
+static struct render_target * get_or_alloc_render_target(void)
+{
+	unsigned int i, w = pvr.draw_x2 - pvr.draw_x1, h = pvr.draw_y2 - pvr.draw_y1;
+	struct render_target *rt, *lru = NULL;
+
+	for (i = 0; i < NB_RENDER_TARGETS; i++) {
+		rt = &pvr.render_targets[i];
+
+		if (rt->tex && rt->x == pvr.draw_x1 && rt->y == pvr.draw_y1
+		    && rt->w == w && rt->h == h) {
+			pvr_stats_add(rt_reused, 1);
+			return rt;
+		}
+
+		if (!lru || !rt->tex || (lru->tex && rt->frame < lru->frame))
+			lru = rt;
+	}
+
+	if (lru->tex) {
+		pvr_printf("Evicting %ux%u render target at %ux%u\n",
+			   lru->w, lru->h, lru->x, lru->y);
+		pvr_free_render_target(lru);
+		pvr_stats_add(rt_evicted, 1);
+	}
+
+	rt = lru;
+	rt->x = pvr.draw_x1;
+	rt->y = pvr.draw_y1;
+	rt->w = w;
+	rt->h = h;
+
+	/* Render target textures must be 32-pixel wide at least */
+	rt->tex_w = next_pow2(max32(w, 32));
+	rt->tex_h = next_pow2(max32(h, 8));
+
+	rt->tex = pvr_mem_malloc(rt->tex_w * rt->tex_h * 2);
+	if (!rt->tex)
+		return NULL;
+
+	rt->seed = pvr_mem_malloc(rt->tex_w * rt->tex_h * 2);
+	if (!rt->seed) {
+		pvr_mem_free(rt->tex);
+		rt->tex = NULL;
+		return NULL;
+	}
+
+	/* Not read by any scene yet */
+	rt->frame = pvr.frame - 2;
+
+	pvr_printf("Created %ux%u render target at %ux%u\n",
+		   rt->w, rt->h, rt->x, rt->y);
+	pvr_stats_add(rt_created, 1);
+
+	return rt;
+}
+
+static void load_render_target_seed(struct render_target *rt)
+{
+	alignas(32) uint16_t line[1024];
+	unsigned int x, y, w = (rt->w + 15) & ~15;
+	uint16_t *dst = rt->seed;
+	const uint16_t *src;
+
+	memset(&line[rt->w], 0, (w - rt->w) * 2);
+
+	/* Convert to the format of the render target: the transparent pixels
+	 * (0x0000) have bit 15 clear, all the others have it set. */
+	for (y = 0; y < rt->h; y++) {
+		src = &gpu.vram[(rt->y + y) * 1024 + rt->x];
+
+		for (x = 0; x < rt->w; x++)
+			line[x] = src[x] ? bgr_to_rgb(src[x]) | 0x8000 : 0;
+
+		pvr_txr_load(line, dst, w * 2);
+		dst += rt->tex_w;
+	}
+}
+
+static void draw_render_target_seed(const struct render_target *rt)
+{
+	const uint32_t colors[4] = { 0xffffff, 0xffffff, 0xffffff, 0xffffff };
+	float u = (float)rt->w / (float)rt->tex_w;
+	float v = (float)rt->h / (float)rt->tex_h;
+	float x[4], y[4], ucoords[4], vcoords[4];
+	bool set_mask, check_mask;
+	pvr_poly_cxt_t cxt;
+
+	x[1] = x[3] = 0.0f;
+	x[0] = x[2] = (float)rt->w;
+	y[0] = y[1] = 0.0f;
+	y[2] = y[3] = (float)rt->h;
+
+	ucoords[1] = ucoords[3] = 0.0f;
+	ucoords[0] = ucoords[2] = u;
+	vcoords[0] = vcoords[1] = 0.0f;
+	vcoords[2] = vcoords[3] = v;
+
+	pvr_poly_cxt_txr(&cxt, PVR_LIST_TR_POLY,
+			 PVR_TXRFMT_ARGB1555 | PVR_TXRFMT_NONTWIDDLED,
+			 rt->tex_w, rt->tex_h, rt->seed, PVR_FILTER_NONE);
+
+	/* Copy the texels, alpha included, like the rectangle fill does */
+	cxt.gen.alpha = PVR_ALPHA_ENABLE;
+	cxt.gen.culling = PVR_CULLING_SMALL;
+	cxt.blend.src = PVR_BLEND_ONE;
+	cxt.blend.dst = PVR_BLEND_ZERO;
+	cxt.txr.env = PVR_TXRENV_REPLACE;
+	cxt.depth.comparison = PVR_DEPTHCMP_ALWAYS;
+
+	/* Draw it below everything else */
+	set_mask = pvr.set_mask;
+	check_mask = pvr.check_mask;
+	pvr.set_mask = 0;
+	pvr.check_mask = 0;
+
+	draw_prim(&cxt, x, y, ucoords, vcoords, colors, 4, 0);
+
+	pvr.set_mask = set_mask;
+	pvr.check_mask = check_mask;
+}
+
+static void pvr_begin_render_target(struct render_target *rt)
+{
+	pvr_ptr_t tex;
+
+	/* The render starts from what the area contains, and not from a
+	 * cleared texture, as the PSX would draw over it. */
+	if (rt->valid) {
+		/* Nothing wrote to the area since it was last rendered, so
+		 * the last render is the background. Render to the other
+		 * buffer: the PVR only writes it when this scene renders,
+		 * after the scenes that read it. */
+		tex = rt->tex;
+		rt->tex = rt->seed;
+		rt->seed = tex;
+	} else {
+		/* The VRAM mirror is more up to date. The seed buffer may
+		 * still be read by a scene in flight. */
+		if (pvr.frame - rt->frame < 2)
+			pvr_wait_render_done();
+
+		load_render_target_seed(rt);
+	}
+
+	pvr_wait_ready();
+	pvr_begin_scene(rt);
+
+	rt->valid = false;
+	rt->frame = pvr.frame;
+	pvr.rt = rt;
+
+	draw_render_target_seed(rt);
+}
+
+static void pvr_update_render_target(void)
+{
+	struct render_target *rt = NULL;
+
+	pvr.draw_area_changed = 0;
+
+	/* Draws to an area outside of the displayed buffers go to a render
+	 * target, as long as the frame's scene did not start yet; the PVR can
+	 * only work on one scene at a time. */
+	if (pvr.new_frame && pvr.draw_x2 > pvr.draw_x1
+	    && pvr.draw_y2 > pvr.draw_y1 && !draw_area_on_screen()) {
+		if (pvr.rt && pvr.rt->x == pvr.draw_x1 && pvr.rt->y == pvr.draw_y1
+		    && pvr.rt->w == pvr.draw_x2 - pvr.draw_x1
+		    && pvr.rt->h == pvr.draw_y2 - pvr.draw_y1)
+			return;
+
+		if (pvr.rt)
+			pvr_end_render_target();
+
+		rt = get_or_alloc_render_target();
+	}
+
+	if (rt == pvr.rt)
+		return;
+
+	if (pvr.rt)
+		pvr_end_render_target();
+
+	if (rt)
+		pvr_begin_render_target(rt);
+}
+
+static struct render_target *
+find_render_target(unsigned int x, unsigned int y,
+		   unsigned int x2, unsigned int y2)
+{
+	struct render_target *rt;
+	unsigned int i;
+
+	for (i = 0; i < NB_RENDER_TARGETS; i++) {
+		rt = &pvr.render_targets[i];
+
+		if (rt->valid && x >= rt->x && x2 <= rt->x + rt->w
+		    && y >= rt->y && y2 <= rt->y + rt->h) {
+			rt->frame = pvr.frame;
+			return rt;
+		}
+	}
+
+	return NULL;
+}
+
+static void pvr_prepare_poly_cxt_rt(pvr_poly_cxt_t *cxt,
+				    const struct render_target *rt)
+{
+	pvr_poly_cxt_txr(cxt, pvr.list,
+			 PVR_TXRFMT_ARGB1555 | PVR_TXRFMT_NONTWIDDLED,
+			 rt->tex_w, rt->tex_h, rt->tex, FILTER_MODE);
+}
+
 static void draw_prim_dma(pvr_poly_cxt_t *cxt,
 			  const float *x, const float *y,
 			  const float *u, const float *v,
@@ -717,6 +1574,165 @@ static void draw_prim_dma(pvr_poly_cxt_t *cxt,
 	}
 
 	pvr_vertbuf_written(list, sizeof(*hdr) + nb * sizeof(*vert));
+
+	if (list == PVR_LIST_OP_POLY)
+		pvr.op_bytes += sizeof(*hdr) + nb * sizeof(*vert);
+}
+
+static bool pack_uv(const pvr_poly_cxt_t *cxt, float u, float v, uint32_t *uv)
+{
+	union fint32 {
+		uint32_t vint;
+		float vf;
+	} fu = { .vf = u }, fv = { .vf = v }, pu, pv;
+
+	/* Sprites only take the upper 16 bits of the texture coordinates.
+	 * Truncating them drops at most the sub-texel bias added by u_to_pvr()
+	 * and v_to_pvr(), which is fine as long as the coordinates still fall
+	 * on the same texel of the largest (1024x512) textures we sample. With
+	 * bilinear filtering, the bias would change the output, so the
+	 * coordinates have to be exact. */
+	pu.vint = fu.vint & 0xffff0000;
+	pv.vint = fv.vint & 0xffff0000;
+
+	if (cxt->txr.filter != PVR_FILTER_NONE) {
+		if (pu.vint != fu.vint || pv.vint != fv.vint)
+			return false;
+	} else if ((int)(pu.vf * 1024.0f) != (int)(u * 1024.0f)
+		   || (int)(pv.vf * 512.0f) != (int)(v * 512.0f)) {
+		return false;
+	}
+
+	*uv = pu.vint | (pv.vint >> 16);
+
+	return true;
+}
+
+static bool prim_is_sprite(const pvr_poly_cxt_t *cxt,
+			   const float *x, const float *y,
+			   const float *u, const float *v,
+			   const uint32_t *color, unsigned int nb,
+			   uint32_t *uv)
+{
+	/* A sprite has one color, and is a parallelogram whose fourth vertex
+	 * (and its texture coordinates) the PVR computes from the other three.
+	 * Primitives are drawn as strips, so test for an axis-aligned
+	 * rectangle with vertices 0/1 and 2/3 on the same line. */
+	if (nb != 4 || color[1] != color[0]
+	    || color[2] != color[0] || color[3] != color[0]
+	    || x[0] != x[2] || x[1] != x[3] || y[0] != y[1] || y[2] != y[3])
+		return false;
+
+	if (!cxt->txr.enable)
+		return true;
+
+	/* The texture must be mapped along the same axes */
+	return u[0] == u[2] && u[1] == u[3] && v[0] == v[1] && v[2] == v[3]
+		&& pack_uv(cxt, u[0], v[0], &uv[0])
+		&& pack_uv(cxt, u[1], v[1], &uv[1])
+		&& pack_uv(cxt, u[3], v[3], &uv[2]);
+}
+
+static void pvr_sprite_compile_from_poly(pvr_sprite_hdr_t *hdr,
+					 const pvr_poly_cxt_t *cxt,
+					 uint32_t argb, uint32_t oargb)
+{
+	pvr_sprite_cxt_t scxt;
+
+	if (cxt->txr.enable) {
+		pvr_sprite_cxt_txr(&scxt, cxt->list_type, cxt->txr.format,
+				   cxt->txr.width, cxt->txr.height,
+				   cxt->txr.base, cxt->txr.filter);
+		scxt.txr.env = cxt->txr.env;
+	} else {
+		pvr_sprite_cxt_col(&scxt, cxt->list_type);
+	}
+
+	scxt.gen.alpha = cxt->gen.alpha;
+	scxt.gen.culling = cxt->gen.culling;
+	scxt.gen.specular = cxt->gen.specular;
+	scxt.depth.comparison = cxt->depth.comparison;
+	scxt.blend.src = cxt->blend.src;
+	scxt.blend.dst = cxt->blend.dst;
+	scxt.blend.src_enable = cxt->blend.src_enable;
+	scxt.blend.dst_enable = cxt->blend.dst_enable;
+
+	pvr_sprite_compile(hdr, &scxt);
+
+	/* Sprites take their colors from the header */
+	hdr->argb = argb;
+	hdr->oargb = oargb;
+}
+
+static void draw_sprite(pvr_poly_cxt_t *cxt,
+			const float *x, const float *y, const uint32_t *uv,
+			uint32_t color, uint32_t oargb)
+{
+	pvr_list_t list = (pvr_list_t)cxt->list_type;
+	pvr_sprite_hdr_t *hdr;
+	pvr_sprite_txr_t *vert;
+	float z = get_zvalue();
+
+	/* The sprite's vertices go around the rectangle, so the strip's last
+	 * two vertices are swapped. */
+	if (WITH_HYBRID_RENDERING && list != pvr.start_list) {
+		hdr = pvr_vertbuf_tail(list);
+		pvr_sprite_compile_from_poly(hdr, cxt, color, oargb);
+		vert = (pvr_sprite_txr_t *)&hdr[1];
+
+		dcache_alloc_block(vert, PVR_CMD_VERTEX_EOL);
+		vert->ax = x[0];
+		vert->ay = y[0];
+		vert->az = z;
+		vert->bx = x[1];
+		vert->by = y[1];
+		vert->bz = z;
+		vert->cx = x[3];
+
+		dcache_alloc_block((void *)vert + 32, 0);
+		vert->cy = y[3];
+		vert->cz = z;
+		vert->dx = x[2];
+		vert->dy = y[2];
+		vert->auv = uv[0];
+		vert->buv = uv[1];
+		vert->cuv = uv[2];
+
+		pvr_vertbuf_written(list, sizeof(*hdr) + sizeof(*vert));
+
+		if (list == PVR_LIST_OP_POLY)
+			pvr.op_bytes += sizeof(*hdr) + sizeof(*vert);
+	} else {
+		hdr = (void *)pvr_dr_target(pvr.dr_state);
+		pvr_sprite_compile_from_poly(hdr, cxt, color, oargb);
+		pvr_dr_commit(hdr);
+
+		vert = (void *)pvr_dr_target(pvr.dr_state);
+		vert->flags = PVR_CMD_VERTEX_EOL;
+		vert->ax = x[0];
+		vert->ay = y[0];
+		vert->az = z;
+		vert->bx = x[1];
+		vert->by = y[1];
+		vert->bz = z;
+		vert->cx = x[3];
+		pvr_dr_commit(vert);
+
+		/* The second half of the vertex goes through the other
+		 * store queue. */
+		vert = (void *)pvr_dr_target(pvr.dr_state) - 32;
+		vert->cy = y[3];
+		vert->cz = z;
+		vert->dx = x[2];
+		vert->dy = y[2];
+		vert->auv = uv[0];
+		vert->buv = uv[1];
+		vert->cuv = uv[2];
+		pvr_dr_commit((void *)vert + 32);
+	}
+
+	pvr_stats_add(sprites, 1);
+	pvr_stats_add(ta_bytes, sizeof(*hdr) + sizeof(*vert));
 }
 
 static void draw_prim(pvr_poly_cxt_t *cxt,
@@ -727,27 +1743,27 @@ static void draw_prim(pvr_poly_cxt_t *cxt,
 {
 	pvr_poly_hdr_t *hdr;
 	pvr_vertex_t *vert;
+	uint32_t uv[3];
 	unsigned int i;
 	float z;
 
-	if (pvr.new_frame) {
+	if (pvr.new_frame && !pvr.rt) {
 		pvr_wait_ready();
 		pvr_reap_textures();
+		pvr_begin_scene(NULL);
 
-		if (WITH_HYBRID_RENDERING) {
-			if (pvr.start_list == PVR_LIST_PT_POLY)
-				pvr_set_vertbuf(PVR_LIST_TR_POLY,
-						vertbuf, sizeof(vertbuf));
-			else
-				pvr_set_vertbuf(PVR_LIST_TR_POLY, NULL, 0);
-		}
+		pvr.new_frame = 0;
+	}
 
-		pvr_scene_begin();
-		pvr_list_begin(pvr.start_list);
+	pvr_stats_add(prims[cxt->list_type], 1);
 
-		pvr.new_frame = 0;
+	if (prim_is_sprite(cxt, x, y, u, v, color, nb, uv)) {
+		draw_sprite(cxt, x, y, uv, color[0], oargb);
+		return;
 	}
 
+	pvr_stats_add(ta_bytes, sizeof(*hdr) + nb * sizeof(*vert));
+
 	if (WITH_HYBRID_RENDERING && cxt->list_type != pvr.start_list) {
 		draw_prim_dma(cxt, x, y, u, v, color, nb, oargb);
 		return;
@@ -789,8 +1805,28 @@ static pvr_ptr_t pvr_get_texture(const struct texture_page *page,
 	return (pvr_ptr_t)&page->vq->codebook4[codebook];
 }
 
+static uint8_t texture_get_alpha(struct texture_page *page,
+				 unsigned int codebook)
+{
+	if (page->settings.bpp == TEXTURE_16BPP)
+		return page->alpha;
+
+	return to_texture_page_4bpp(page)->clut[codebook].alpha;
+}
+
+static bool pvr_op_list_has_room(unsigned int nb)
+{
+	if (pvr.op_bytes + sizeof(pvr_poly_hdr_t)
+	    + nb * sizeof(pvr_vertex_t) <= sizeof(op_vertbuf))
+		return true;
+
+	pvr_stats_add(op_list_full, 1);
+
+	return false;
+}
+
 static void load_mask_texture(struct texture_page *page,
-			      uint16_t clut,
+			      uint32_t clut,
 			      const float *xcoords, const float *ycoords,
 			      const float *ucoords, const float *vcoords,
 			      const uint32_t *colors,
@@ -866,14 +1902,53 @@ static void draw_poly(pvr_poly_cxt_t *cxt,
 	const float *old_vcoords = vcoords;
 	float new_vcoords[4];
 	uint32_t *colors_alt;
+	uint32_t tex_clut = clut;
+	uint32_t sat_mask, color_mask;
+	uint8_t alpha = 0;
 	unsigned int i;
 	int txr_en;
 
+	if (bright && tex_page && tex_page->settings.bpp != TEXTURE_16BPP) {
+		/* Vertex colors above 0x80 make the PSX output up to twice as
+		 * bright as the texels, which the PVR cannot do in one pass.
+		 * Sample a copy of the palette with its colors doubled
+		 * instead. This is exact as long as the components that
+		 * saturate once doubled are modulated by 0xff, as they
+		 * would saturate on the PSX as well. */
+		sat_mask = to_texture_page_4bpp(tex_page)->clut[codebook].sat_mask;
+		color_mask = colors[0];
+
+		for (i = 1; i < nb; i++)
+			color_mask &= colors[i];
+
+		if ((color_mask & sat_mask) == sat_mask) {
+			tex_clut |= CLUT_IS_BRIGHT;
+			codebook = find_texture_codebook(tex_page, tex_clut);
+			cxt->txr.base = pvr_get_texture(tex_page, codebook);
+			bright = false;
+
+			pvr_stats_add(bright_single_pass, 1);
+		} else {
+			pvr_stats_add(bright_two_pass, 1);
+		}
+	} else if (bright) {
+		pvr_stats_add(bright_two_pass, 1);
+	}
+
 	if (tex_page) {
 		memcpy(new_vcoords, vcoords, nb * sizeof(*vcoords));
 		adjust_vcoords(new_vcoords, nb, tex_page->settings.bpp, codebook);
 
 		vcoords = new_vcoords;
+
+		alpha = texture_get_alpha(tex_page, codebook);
+
+		/* Semi-transparency only applies to texels with bit 15 set. If
+		 * the texture has none, the primitive can be drawn as opaque,
+		 * which in hybrid mode may get it into the OP list. */
+		if (WITH_HYBRID_RENDERING && cxt->list_type == PVR_LIST_PT_POLY
+		    && !(alpha & TEXTURE_ALPHA_TRANSLUCENT))
+			blending_mode = BLENDING_MODE_NONE;
 	}
 
 	cxt->gen.culling = PVR_CULLING_SMALL;
@@ -881,8 +1956,23 @@ static void draw_poly(pvr_poly_cxt_t *cxt,
 
 	switch (blending_mode) {
 	case BLENDING_MODE_NONE:
-		cxt->blend.src = PVR_BLEND_SRCALPHA;
-		cxt->blend.dst = PVR_BLEND_INVSRCALPHA;
+		if (cxt->list_type == PVR_LIST_PT_POLY
+		    && (tex_page || !cxt->txr.enable)
+		    && !(alpha & TEXTURE_ALPHA_PUNCH_THROUGH)
+		    && pvr_op_list_has_room(nb)) {
+			/* Without transparent texels, the primitive can be
+			 * rendered in the cheaper opaque list. The draw order
+			 * is kept, as the Z value still increases with each
+			 * primitive, whatever the list. Render targets are not
+			 * classified, so primitives sampling one stay in the
+			 * PT list. */
+			cxt->list_type = PVR_LIST_OP_POLY;
+			cxt->blend.src = PVR_BLEND_ONE;
+			cxt->blend.dst = PVR_BLEND_ZERO;
+		} else {
+			cxt->blend.src = PVR_BLEND_SRCALPHA;
+			cxt->blend.dst = PVR_BLEND_INVSRCALPHA;
+		}
 
 		draw_prim(cxt, xcoords, ycoords, ucoords, vcoords, colors, nb, 0);
 
@@ -1065,7 +2155,7 @@ static void draw_poly(pvr_poly_cxt_t *cxt,
 		/* If we are blending with a texture, copy back opaque
 		 * non-semi-transparent pixels stored in the mask texture to
 		 * the destination. */
-		load_mask_texture(tex_page, clut, xcoords, ycoords,
+		load_mask_texture(tex_page, tex_clut, xcoords, ycoords,
 				  ucoords, old_vcoords, colors, nb, bright);
 	}
 }
@@ -1161,21 +2251,15 @@ static void pvr_prepare_poly_cxt_txr(pvr_poly_cxt_t *cxt,
 			 tex_width, tex_height, tex, FILTER_MODE);
 }
 
-static bool overlap_draw_area(uint32_t x, uint32_t y, uint32_t w, uint32_t h)
-{
-	return x < pvr.draw_x2
-		&& y < pvr.draw_y2
-		&& x + w > pvr.draw_x1
-		&& y + h > pvr.draw_y1;
-}
-
 static void cmd_clear_image(const union PacketBuffer *pbuffer)
 {
-	int32_t x0, y0, w0, h0;
+	int32_t x0, y0, w0, h0, fx0, fy0, fx1, fy1;
 	pvr_poly_cxt_t cxt;
 	float x[4], y[4];
 	uint32_t colors[4];
 	bool set_mask, check_mask;
+	unsigned int dx, dy;
+	uint16_t pixel, *line;
 
 	/* horizontal position / size work in 16-pixel blocks */
 	x0 = pbuffer->U2[2] & 0x3f0;
@@ -1183,13 +2267,37 @@ static void cmd_clear_image(const union PacketBuffer *pbuffer)
 	w0 = ((pbuffer->U2[4] & 0x3f0) + 0xf) & ~0xf;
 	h0 = pbuffer->U2[5] & 0x1ff;
 
-	if (overlap_draw_area(x0, y0, w0, h0)) {
-		x[1] = x[3] = x_to_pvr(max32(x0, pvr.draw_x1));
-		y[0] = y[1] = y_to_pvr(max32(y0, pvr.draw_y1));
-		x[0] = x[2] = x_to_pvr(min32(x0 + w0, pvr.draw_x2));
-		y[2] = y[3] = y_to_pvr(min32(y0 + h0, pvr.draw_y2));
+	/* Move the fill by the drawing offset like the other primitives, then
+	 * clip it to the drawing area, which is also the extent of the render
+	 * target when drawing to one. */
+	fx0 = x0 + pvr.draw_dx;
+	fy0 = y0 + pvr.draw_dy;
+	fx1 = fx0 + w0;
+	fy1 = fy0 + h0;
+
+	if (fx0 < pvr.draw_x1)
+		fx0 = pvr.draw_x1;
+	if (fy0 < pvr.draw_y1)
+		fy0 = pvr.draw_y1;
+	if (fx1 > pvr.draw_x2)
+		fx1 = pvr.draw_x2;
+	if (fy1 > pvr.draw_y2)
+		fy1 = pvr.draw_y2;
+
+	if (fx0 < fx1 && fy0 < fy1) {
+		x[1] = x[3] = x_to_pvr(fx0 - pvr.draw_dx);
+		y[0] = y[1] = y_to_pvr(fy0 - pvr.draw_dy);
+		x[0] = x[2] = x_to_pvr(fx1 - pvr.draw_dx);
+		y[2] = y[3] = y_to_pvr(fy1 - pvr.draw_dy);
 
 		colors[0] = __builtin_bswap32(pbuffer->U4[0]) >> 8;
+
+		/* When drawing to a render target, write the alpha channel
+		 * as well, so that a black fill makes the area transparent
+		 * when the render target is sampled. */
+		if (pvr.rt && colors[0])
+			colors[0] |= 0xff000000;
+
 		colors[3] = colors[2] = colors[1] = colors[0];
 
 		pvr_poly_cxt_col(&cxt, PVR_LIST_TR_POLY);
@@ -1204,15 +2312,37 @@ static void cmd_clear_image(const union PacketBuffer *pbuffer)
 		pvr.set_mask = 0;
 		pvr.check_mask = 0;
 
-		draw_poly(&cxt, x, y, x, y,
-			  colors, 4, BLENDING_MODE_NONE, false, NULL, 0, 0);
+		if (pvr.rt) {
+			cxt.gen.alpha = PVR_ALPHA_ENABLE;
+			cxt.blend.src = PVR_BLEND_ONE;
+			cxt.blend.dst = PVR_BLEND_ZERO;
+
+			draw_prim(&cxt, x, y, x, y, colors, 4, 0);
+		} else {
+			draw_poly(&cxt, x, y, x, y,
+				  colors, 4, BLENDING_MODE_NONE, false, NULL, 0, 0);
+		}
 
 		pvr.set_mask = set_mask;
 		pvr.check_mask = check_mask;
 	}
 
-	/* TODO: Invalidate anything in the framebuffer, texture and palette
-	 * caches that are covered by this rectangle */
+	/* Update the VRAM mirror, so that textures and palettes sourced from
+	 * the filled area are valid */
+	pixel = (pbuffer->U1[0] >> 3)
+		| (uint16_t)(pbuffer->U1[1] >> 3) << 5
+		| (uint16_t)(pbuffer->U1[2] >> 3) << 10;
+
+	for (dy = 0; dy < h0; dy++) {
+		line = &gpu.vram[((y0 + dy) & 0x1ff) * 1024];
+
+		for (dx = 0; dx < w0; dx++)
+			line[(x0 + dx) & 0x3ff] = pixel;
+	}
+
+	/* Patch or invalidate the cached textures and palettes */
+	if (w0 && h0)
+		renderer_update_caches(x0, y0, w0, h0, 0);
 }
 
 static void adjust_vcoords(float *vcoords, unsigned int nb,
@@ -1265,6 +2395,9 @@ int do_cmd_list(uint32_t *list, int list_len,
 
 		pbuffer = (const union PacketBuffer *)list;
 
+		if (pvr.draw_area_changed && (cmd == 0x02 || (cmd >= 0x20 && cmd < 0x80)))
+			pvr_update_render_target();
+
 		multicolor = cmd & 0x10;
 		multiple = cmd & 0x08;
 		textured = cmd & 0x04;
@@ -1315,6 +2448,7 @@ int do_cmd_list(uint32_t *list, int list_len,
 				/* Set top-left corner of drawing area */
 				pvr.draw_x1 = pbuffer->U4[0] & 0x3ff;
 				pvr.draw_y1 = (pbuffer->U4[0] >> 10) & 0x1ff;
+				pvr.draw_area_changed = 1;
 				if (0)
 					pvr_printf("Set top-left corner to %ux%u\n",
 						   pvr.draw_x1, pvr.draw_y1);
@@ -1324,6 +2458,7 @@ int do_cmd_list(uint32_t *list, int list_len,
 				/* Set bottom-right corner of drawing area */
 				pvr.draw_x2 = (pbuffer->U4[0] & 0x3ff) + 1;
 				pvr.draw_y2 = ((pbuffer->U4[0] >> 10) & 0x1ff) + 1;
+				pvr.draw_area_changed = 1;
 				if (0)
 					pvr_printf("Set bottom-right corner to %ux%u\n",
 						   pvr.draw_x2, pvr.draw_y2);
@@ -1379,7 +2514,8 @@ int do_cmd_list(uint32_t *list, int list_len,
 			float ucoords[4] = {}, vcoords[4] = {};
 			struct texture_settings settings;
 			uint32_t colors[4], texcoord[4];
-			unsigned int page_x, page_y;
+			unsigned int page_x, page_y, umin, umax, vmin, vmax;
+			struct render_target *rt = NULL;
 			uint16_t texpage, clut = 0;
 			bool bright = false;
 			uint32_t val;
@@ -1430,9 +2566,43 @@ int do_cmd_list(uint32_t *list, int list_len,
 				page_x = texpage & 0xf;
 				page_y = (texpage >> 4) & 0x1;
 
-				tex_page = get_or_alloc_texture(page_x, page_y, clut,
-								settings, &codebook);
-				pvr_prepare_poly_cxt_txr(&cxt, tex_page, codebook);
+				vmin = vmax = (uint8_t)(texcoord[0] >> 8);
+
+				for (i = 1; i < nb; i++) {
+					vmin = min32(vmin, (uint8_t)(texcoord[i] >> 8));
+					vmax = max32(vmax, (uint8_t)(texcoord[i] >> 8));
+				}
+
+				if (settings.bpp == TEXTURE_16BPP
+				    && !settings.mask_x && !settings.mask_y) {
+					umin = umax = (uint8_t)texcoord[0];
+
+					for (i = 1; i < nb; i++) {
+						umin = min32(umin, (uint8_t)texcoord[i]);
+						umax = max32(umax, (uint8_t)texcoord[i]);
+					}
+
+					rt = find_render_target(page_x * 64 + umin,
+								page_y * 256 + vmin,
+								page_x * 64 + umax + 1,
+								page_y * 256 + vmax + 1);
+				}
+
+				if (rt) {
+					/* The texture was rendered by the PVR;
+					 * sample the render target directly. */
+					for (i = 0; i < nb; i++) {
+						ucoords[i] = u_to_rt(rt, page_x * 64 + (uint8_t)texcoord[i]);
+						vcoords[i] = v_to_rt(rt, page_y * 256 + (uint8_t)(texcoord[i] >> 8));
+					}
+
+					pvr_prepare_poly_cxt_rt(&cxt, rt);
+				} else {
+					tex_page = get_or_alloc_texture(page_x, page_y, clut, settings,
+									texture_get_bands(settings, vmin, vmax),
+									&codebook);
+					pvr_prepare_poly_cxt_txr(&cxt, tex_page, codebook);
+				}
 
 				if (semi_trans)
 					blending_mode = (enum blending_mode)((texpage >> 5) & 0x3);
@@ -1512,6 +2682,7 @@ int do_cmd_list(uint32_t *list, int list_len,
 			/* Monochrome rectangle */
 			float x[4], y[4];
 			float ucoords[4] = {}, vcoords[4] = {};
+			struct render_target *rt = NULL;
 			uint32_t colors[4];
 			uint16_t w, h, x0, y0, clut = 0;
 			bool bright = false;
@@ -1556,7 +2727,25 @@ int do_cmd_list(uint32_t *list, int list_len,
 			y[0] = y[1] = y_to_pvr(y0);
 			y[2] = y[3] = y_to_pvr(y0 + h);
 
-			if (textured) {
+			if (textured && pvr.settings.bpp == TEXTURE_16BPP
+			    && !pvr.settings.mask_x && !pvr.settings.mask_y) {
+				rt = find_render_target(pvr.page_x * 64 + pbuffer->U1[8],
+							pvr.page_y * 256 + pbuffer->U1[9],
+							pvr.page_x * 64 + pbuffer->U1[8] + w,
+							pvr.page_y * 256 + pbuffer->U1[9] + h);
+			}
+
+			if (rt) {
+				/* The texture was rendered by the PVR; sample
+				 * the render target directly. */
+				ucoords[1] = ucoords[3] = u_to_rt(rt, pvr.page_x * 64 + pbuffer->U1[8]);
+				ucoords[0] = ucoords[2] = u_to_rt(rt, pvr.page_x * 64 + pbuffer->U1[8] + w);
+
+				vcoords[0] = vcoords[1] = v_to_rt(rt, pvr.page_y * 256 + pbuffer->U1[9]);
+				vcoords[2] = vcoords[3] = v_to_rt(rt, pvr.page_y * 256 + pbuffer->U1[9] + h);
+
+				pvr_prepare_poly_cxt_rt(&cxt, rt);
+			} else if (textured) {
 				ucoords[1] = ucoords[3] = u_to_pvr(pbuffer->U1[8]);
 				ucoords[0] = ucoords[2] = u_to_pvr(pbuffer->U1[8] + w);
 
@@ -1565,8 +2754,11 @@ int do_cmd_list(uint32_t *list, int list_len,
 
 				clut = pbuffer->U2[5] & 0x7fff;
 
-				tex_page = get_or_alloc_texture(pvr.page_x, pvr.page_y, clut,
-								pvr.settings, &codebook);
+				tex_page = get_or_alloc_texture(pvr.page_x, pvr.page_y, clut, pvr.settings,
+								texture_get_bands(pvr.settings,
+										  pbuffer->U1[9],
+										  pbuffer->U1[9] + h - 1),
+								&codebook);
 				pvr_prepare_poly_cxt_txr(&cxt, tex_page, codebook);
 			} else {
 				pvr_poly_cxt_col(&cxt, pvr.list);
@@ -1603,6 +2795,7 @@ out:
 void hw_render_start(void)
 {
 	pvr.new_frame = 1;
+	pvr.frame++;
 	pvr.zoffset = 0;
 	pvr.depthcmp = PVR_DEPTHCMP_GEQUAL;
 
@@ -1614,10 +2807,48 @@ void hw_render_start(void)
 	pvr.list = pvr.start_list;
 }
 
-void hw_render_stop(void)
+static void pvr_print_stats(void)
 {
-	if (!pvr.new_frame) {
-		pvr_list_finish();
-		pvr_scene_finish();
+	pvr_stats_t stats;
+
+	if (!STATS)
+		return;
+
+	stats_printf("Textures: %u invalidated, %u converted, %u kept, %u patched, %u CLUTs invalidated\n",
+		     pvr.stats.pages_invalidated, pvr.stats.pages_converted,
+		     pvr.stats.pages_kept, pvr.stats.pages_patched,
+		     pvr.stats.cluts_invalidated);
+	stats_printf("Texture uploads: %u bytes converted, %u bytes patched\n",
+		     pvr.stats.bytes_converted, pvr.stats.bytes_patched);
+	stats_printf("Render targets: %u created, %u reused, %u evicted\n",
+		     pvr.stats.rt_created, pvr.stats.rt_reused,
+		     pvr.stats.rt_evicted);
+	stats_printf("Primitives: %u OP, %u PT, %u TR, OP list full %u times\n",
+		     pvr.stats.prims[PVR_LIST_OP_POLY],
+		     pvr.stats.prims[PVR_LIST_PT_POLY],
+		     pvr.stats.prims[PVR_LIST_TR_POLY],
+		     pvr.stats.op_list_full);
+	stats_printf("TA: %u bytes, %u primitives sent as sprites\n",
+		     pvr.stats.ta_bytes, pvr.stats.sprites);
+	stats_printf("Bright primitives: %u single-pass, %u two-pass\n",
+		     pvr.stats.bright_single_pass, pvr.stats.bright_two_pass);
+
+	if (!pvr_get_stats(&stats)) {
+		stats_printf("Last frame: registration %llu, render %llu\n",
+			     (unsigned long long)stats.reg_last_time,
+			     (unsigned long long)stats.rnd_last_time);
 	}
+
+	memset(&pvr.stats, 0, sizeof(pvr.stats));
+}
+
+void hw_render_stop(void)
+{
+	if (pvr.rt)
+		pvr_end_render_target();
+
+	if (!pvr.new_frame)
+		pvr_finish_scene(false);
+
+	pvr_print_stats();
 }
@@ -0,0 +1,202 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Minimal stand-in for KallistiOS' <dc/pvr.h>, so that the PVR renderer can
+ * be built and checked on the host. Only what src/pvr.c uses is provided.
+ * The functions are implemented in kos-stubs.c, and record the calls that
+ * the tests want to check.
+ */
+
+#ifndef __TESTS_DC_PVR_H
+#define __TESTS_DC_PVR_H
+
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void *pvr_ptr_t;
+typedef uint32_t pvr_list_t;
+
+#define PVR_LIST_OP_POLY	0
+#define PVR_LIST_OP_MOD		1
+#define PVR_LIST_TR_POLY	2
+#define PVR_LIST_TR_MOD		3
+#define PVR_LIST_PT_POLY	4
+
+#define PVR_CMD_VERTEX		0xe0000000
+#define PVR_CMD_VERTEX_EOL	0xf0000000
+
+#define PVR_ALPHA_DISABLE	0
+#define PVR_ALPHA_ENABLE	1
+
+#define PVR_BLEND_ZERO		0
+#define PVR_BLEND_ONE		1
+#define PVR_BLEND_DESTCOLOR	2
+#define PVR_BLEND_INVDESTCOLOR	3
+#define PVR_BLEND_SRCALPHA	4
+#define PVR_BLEND_INVSRCALPHA	5
+
+#define PVR_BLEND_DISABLE	0
+#define PVR_BLEND_ENABLE	1
+
+#define PVR_CULLING_SMALL	1
+
+#define PVR_DEPTHCMP_ALWAYS	7
+#define PVR_DEPTHCMP_GEQUAL	6
+
+#define PVR_FILTER_NONE		0
+#define PVR_FILTER_BILINEAR	2
+
+#define PVR_SPECULAR_DISABLE	0
+#define PVR_SPECULAR_ENABLE	1
+
+#define PVR_TEXTURE_DISABLE	0
+#define PVR_TEXTURE_ENABLE	1
+
+#define PVR_TXRENV_REPLACE	0
+#define PVR_TXRENV_MODULATE	1
+
+#define PVR_TXRFMT_ARGB1555	(0 << 27)
+#define PVR_TXRFMT_NONTWIDDLED	(1 << 26)
+#define PVR_TXRFMT_VQ_ENABLE	(1 << 30)
+
+#define PVR_PAL_ARGB1555	0
+
+#define PVR_FB_CFG_2		0x0048
+
+#define PVR_GET(reg)		pvr_stub_get_reg(reg)
+#define PVR_SET(reg, val)	pvr_stub_set_reg(reg, val)
+
+typedef struct {
+	int list_type;
+	struct {
+		int alpha;
+		int shading;
+		int fog_type;
+		int culling;
+		int color_clamp;
+		int clip_mode;
+		int modifier_mode;
+		int specular;
+		int alpha2;
+		int fog_type2;
+		int color_clamp2;
+	} gen;
+	struct {
+		int src;
+		int dst;
+		int src_enable;
+		int dst_enable;
+	} blend;
+	struct {
+		int color;
+		int uv;
+		int modifier;
+	} fmt;
+	struct {
+		int comparison;
+		int write;
+	} depth;
+	struct {
+		int enable;
+		int filter;
+		int mipmap;
+		int mipmap_bias;
+		int uv_flip;
+		int uv_clamp;
+		int alpha;
+		int env;
+		int width;
+		int height;
+		int format;
+		pvr_ptr_t base;
+	} txr;
+} pvr_poly_cxt_t;
+
+typedef pvr_poly_cxt_t pvr_sprite_cxt_t;
+
+typedef struct {
+	uint32_t cmd;
+	uint32_t mode1, mode2, mode3;
+	uint32_t d1, d2, d3, d4;
+} pvr_poly_hdr_t;
+
+typedef struct {
+	uint32_t cmd;
+	uint32_t mode1, mode2, mode3;
+	uint32_t argb, oargb;
+	uint32_t d1, d2;
+} pvr_sprite_hdr_t;
+
+typedef struct {
+	uint32_t flags;
+	float x, y, z;
+	float u, v;
+	uint32_t argb, oargb;
+} pvr_vertex_t;
+
+typedef struct {
+	uint32_t flags;
+	float ax, ay, az;
+	float bx, by, bz;
+	float cx, cy, cz;
+	float dx, dy;
+	uint32_t dummy;
+	uint32_t auv, buv, cuv;
+} pvr_sprite_txr_t;
+
+typedef struct {
+	uint64_t frame_last_time;
+	uint64_t reg_last_time;
+	uint64_t rnd_last_time;
+	uint64_t buf_last_time;
+	size_t frame_count;
+	size_t vbl_count;
+	size_t vtx_buffer_used;
+	size_t vtx_buffer_used_max;
+	float frame_rate;
+	uint32_t enabled_list_mask;
+} pvr_stats_t;
+
+#define pvr_dr_target(state)	((pvr_vertex_t *)pvr_stub_dr_target())
+#define pvr_dr_commit(addr)	pvr_stub_dr_commit(addr)
+
+void *pvr_stub_dr_target(void);
+void pvr_stub_dr_commit(void *addr);
+
+uint32_t pvr_stub_get_reg(uint32_t reg);
+void pvr_stub_set_reg(uint32_t reg, uint32_t val);
+
+pvr_ptr_t pvr_mem_malloc(size_t size);
+void pvr_mem_free(pvr_ptr_t ptr);
+void pvr_txr_load(const void *src, pvr_ptr_t dst, uint32_t count);
+
+void pvr_set_pal_format(int fmt);
+void pvr_set_pal_entry(uint32_t idx, uint32_t value);
+
+int pvr_set_vertbuf(pvr_list_t list, void *buffer, size_t len);
+void *pvr_vertbuf_tail(pvr_list_t list);
+void pvr_vertbuf_written(pvr_list_t list, size_t amt);
+
+int pvr_wait_ready(void);
+void pvr_wait_render_done(void);
+void pvr_scene_begin(void);
+void pvr_scene_begin_txr(pvr_ptr_t txr, size_t *rx, size_t *ry);
+int pvr_scene_finish(void);
+int pvr_list_begin(pvr_list_t list);
+int pvr_list_finish(void);
+int pvr_get_stats(pvr_stats_t *stat);
+
+void pvr_poly_cxt_col(pvr_poly_cxt_t *dst, pvr_list_t list);
+void pvr_poly_cxt_txr(pvr_poly_cxt_t *dst, pvr_list_t list, int textureformat,
+		      int tw, int th, pvr_ptr_t textureaddr, int filtering);
+void pvr_sprite_cxt_col(pvr_sprite_cxt_t *dst, pvr_list_t list);
+void pvr_sprite_cxt_txr(pvr_sprite_cxt_t *dst, pvr_list_t list,
+			int textureformat, int tw, int th,
+			pvr_ptr_t textureaddr, int filtering);
+void pvr_poly_compile(pvr_poly_hdr_t *dst, const pvr_poly_cxt_t *src);
+void pvr_sprite_compile(pvr_sprite_hdr_t *dst, const pvr_sprite_cxt_t *src);
+
+void dcache_alloc_block(void *addr, uint32_t value);
+
+#endif /* __TESTS_DC_PVR_H */
@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Minimal stand-in for KallistiOS' <kos/string.h>.
+ */
+
+#ifndef __TESTS_KOS_STRING_H
+#define __TESTS_KOS_STRING_H
+
+#include <string.h>
+
+#endif /* __TESTS_KOS_STRING_H */
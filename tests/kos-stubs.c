@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Host stubs for the KallistiOS PVR API and the gpulib video output
+ *
+ * Textures live in host memory, so that the tests can compare them with the
+ * VRAM mirror. Vertices are discarded; only the scene and list sequence is
+ * recorded and checked.
+ */
+
+#include <dc/pvr.h>
+#include <gpulib/gpu.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kos-stubs.h"
+
+/* Framebuffer pixel format: KOS renders to RGB565, render targets are
+ * written as ARGB1555. */
+#define FB_PACKMODE_RGB565	1
+#define FB_PACKMODE_ARGB1555	3
+
+struct pvr_stub_state pvr_stub;
+
+static uint32_t fb_cfg_2 = FB_PACKMODE_RGB565;
+alignas(32) static unsigned char dr_buf[128];
+alignas(32) static unsigned char vertbufs[PVR_LIST_PT_POLY + 1][0x20000];
+
+float screen_fw = 1.0f, screen_fh = 1.0f;
+
+#define stub_error(...) do {						\
+	fprintf(stderr, __VA_ARGS__);					\
+	pvr_stub.errors++;						\
+} while (0)
+
+void pvr_stub_reset(void)
+{
+	memset(&pvr_stub, 0, sizeof(pvr_stub));
+	fb_cfg_2 = FB_PACKMODE_RGB565;
+}
+
+void *pvr_stub_dr_target(void)
+{
+	/* Sprites write their second half 32 bytes below the target */
+	return &dr_buf[64];
+}
+
+void pvr_stub_dr_commit(void *addr)
+{
+	if (!pvr_stub.in_list)
+		stub_error("Vertex data submitted outside of a list\n");
+}
+
+uint32_t pvr_stub_get_reg(uint32_t reg)
+{
+	return reg == PVR_FB_CFG_2 ? fb_cfg_2 : 0;
+}
+
+void pvr_stub_set_reg(uint32_t reg, uint32_t val)
+{
+	if (reg != PVR_FB_CFG_2)
+		return;
+
+	/* The framebuffer format is read when a render starts, so it can't
+	 * change until the render of the last finished scene is done. */
+	if (pvr_stub.render_pending)
+		stub_error("FB_CFG_2 written while a render is pending\n");
+
+	fb_cfg_2 = val;
+	pvr_stub.fb_cfg_writes++;
+}
+
+pvr_ptr_t pvr_mem_malloc(size_t size)
+{
+	return aligned_alloc(32, (size + 31) & ~31);
+}
+
+void pvr_mem_free(pvr_ptr_t ptr)
+{
+	free(ptr);
+}
+
+void pvr_txr_load(const void *src, pvr_ptr_t dst, uint32_t count)
+{
+	memcpy(dst, src, count);
+}
+
+void pvr_set_pal_format(int fmt)
+{
+}
+
+void pvr_set_pal_entry(uint32_t idx, uint32_t value)
+{
+}
+
+int pvr_set_vertbuf(pvr_list_t list, void *buffer, size_t len)
+{
+	return 0;
+}
+
+void *pvr_vertbuf_tail(pvr_list_t list)
+{
+	return vertbufs[list];
+}
+
+void pvr_vertbuf_written(pvr_list_t list, size_t amt)
+{
+	if (!pvr_stub.in_scene)
+		stub_error("Vertex buffer written outside of a scene\n");
+}
+
+int pvr_wait_ready(void)
+{
+	return 0;
+}
+
+void pvr_wait_render_done(void)
+{
+	pvr_stub.render_pending = false;
+	pvr_stub.render_waits++;
+}
+
+static void pvr_stub_scene_begin(bool txr)
+{
+	if (pvr_stub.in_scene)
+		stub_error("Scene begun while another one is in progress\n");
+
+	pvr_stub.in_scene = true;
+	pvr_stub.scene_txr = txr;
+	pvr_stub.scenes++;
+
+	if (txr)
+		pvr_stub.txr_scenes++;
+}
+
+void pvr_scene_begin(void)
+{
+	pvr_stub_scene_begin(false);
+}
+
+void pvr_scene_begin_txr(pvr_ptr_t txr, size_t *rx, size_t *ry)
+{
+	pvr_stub_scene_begin(true);
+}
+
+int pvr_scene_finish(void)
+{
+	unsigned int packmode = pvr_stub.scene_txr
+		? FB_PACKMODE_ARGB1555 : FB_PACKMODE_RGB565;
+
+	if (!pvr_stub.in_scene || pvr_stub.in_list)
+		stub_error("Scene finished in an invalid state\n");
+
+	/* The scene can start rendering from now on */
+	if ((fb_cfg_2 & 0x7) != packmode)
+		stub_error("Scene rendered with packmode %u instead of %u\n",
+			   fb_cfg_2 & 0x7, packmode);
+
+	pvr_stub.in_scene = false;
+	pvr_stub.render_pending = true;
+	pvr_stub.scenes_finished++;
+
+	return 0;
+}
+
+int pvr_list_begin(pvr_list_t list)
+{
+	if (!pvr_stub.in_scene || pvr_stub.in_list)
+		stub_error("List %u begun in an invalid state\n", list);
+
+	pvr_stub.in_list = true;
+
+	return 0;
+}
+
+int pvr_list_finish(void)
+{
+	if (!pvr_stub.in_list)
+		stub_error("List finished while none was open\n");
+
+	pvr_stub.in_list = false;
+
+	return 0;
+}
+
+int pvr_get_stats(pvr_stats_t *stat)
+{
+	memset(stat, 0, sizeof(*stat));
+
+	return 0;
+}
+
+void pvr_poly_cxt_col(pvr_poly_cxt_t *dst, pvr_list_t list)
+{
+	memset(dst, 0, sizeof(*dst));
+	dst->list_type = list;
+	dst->txr.enable = PVR_TEXTURE_DISABLE;
+}
+
+void pvr_poly_cxt_txr(pvr_poly_cxt_t *dst, pvr_list_t list, int textureformat,
+		      int tw, int th, pvr_ptr_t textureaddr, int filtering)
+{
+	memset(dst, 0, sizeof(*dst));
+	dst->list_type = list;
+	dst->txr.enable = PVR_TEXTURE_ENABLE;
+	dst->txr.format = textureformat;
+	dst->txr.width = tw;
+	dst->txr.height = th;
+	dst->txr.base = textureaddr;
+	dst->txr.filter = filtering;
+}
+
+void pvr_sprite_cxt_col(pvr_sprite_cxt_t *dst, pvr_list_t list)
+{
+	pvr_poly_cxt_col(dst, list);
+}
+
+void pvr_sprite_cxt_txr(pvr_sprite_cxt_t *dst, pvr_list_t list,
+			int textureformat, int tw, int th,
+			pvr_ptr_t textureaddr, int filtering)
+{
+	pvr_poly_cxt_txr(dst, list, textureformat, tw, th,
+			 textureaddr, filtering);
+}
+
+void pvr_poly_compile(pvr_poly_hdr_t *dst, const pvr_poly_cxt_t *src)
+{
+	memset(dst, 0, sizeof(*dst));
+}
+
+void pvr_sprite_compile(pvr_sprite_hdr_t *dst, const pvr_sprite_cxt_t *src)
+{
+	memset(dst, 0, sizeof(*dst));
+}
+
+void dcache_alloc_block(void *addr, uint32_t value)
+{
+	memset(addr, 0, 32);
+	*(uint32_t *)addr = value;
+}
+
+/* gpulib video output, and the hooks that the frontend normally provides */
+
+int vout_init(void)
+{
+	return 0;
+}
+
+int vout_finish(void)
+{
+	return 0;
+}
+
+void vout_update(void)
+{
+}
+
+void vout_blank(void)
+{
+}
+
+void vout_set_config(const struct rearmed_cbs *config)
+{
+}
+
+void renderer_set_interlace(int enable, int is_odd)
+{
+}
@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Host stubs for the KallistiOS PVR API - call recording
+ */
+
+#ifndef __TESTS_KOS_STUBS_H
+#define __TESTS_KOS_STUBS_H
+
+#include <stdbool.h>
+
+struct pvr_stub_state {
+	bool in_scene;
+	bool in_list;
+	bool scene_txr;
+	bool render_pending;
+
+	unsigned int scenes;
+	unsigned int txr_scenes;
+	unsigned int scenes_finished;
+	unsigned int render_waits;
+	unsigned int fb_cfg_writes;
+	unsigned int errors;
+};
+
+extern struct pvr_stub_state pvr_stub;
+
+void pvr_stub_reset(void);
+
+#endif /* __TESTS_KOS_STUBS_H */
@@ -0,0 +1,342 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Unaligned access checks for Lightrec
+ *
+ * LWL, LWR, SWL and SWR tagged as direct hardware accesses are emitted
+ * inline by the recompiler. Run them on every alignment, with constant
+ * addresses in both the KUSEG and KSEG1 views of the hardware registers,
+ * immediate offsets that do and don't carry the alignment, and with rt
+ * being the base register, through the recompiler and the interpreter.
+ * The registers and the memory around the access must be identical.
+ *
+ * Usage: lightrec-partial [values per block]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <lightrec.h>
+
+#include "test.h"
+
+#define RAM_SIZE	0x200000
+#define HW_BASE		0x1f801000
+#define HW_SIZE		0x8000
+
+#define CODE_BASE	0x80010000
+
+/* Around 0x1f802000, clear of the FIFOs and DMA registers */
+#define HW_TEST_AREA	0x1000
+
+enum {
+	OP_LWL = 0x22,
+	OP_LWR = 0x26,
+	OP_SWL = 0x2a,
+	OP_SWR = 0x2e,
+};
+
+struct cpu {
+	struct lightrec_state *state;
+	struct lightrec_mem_map maps[PSX_MAP_CODE_BUFFER];
+	uint32_t *ram;
+	uint8_t *hw;
+};
+
+static unsigned int failures;
+static unsigned int hw_direct_calls, hw_ops_calls;
+static uint32_t seed = 0x68e31da4;
+
+static uint32_t rand32(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+
+	return seed;
+}
+
+static uint32_t random_value(void)
+{
+	static const uint32_t edges[] = {
+		0, 0xffffffff, 0x80000000, 0x7fffffff, 0x000000ff, 0xff000000,
+		0x00ff00ff, 0xff00ff00, 0x01234567, 0x89abcdef,
+	};
+
+	if (rand32() & 3)
+		return rand32();
+
+	return edges[rand32() % (sizeof(edges) / sizeof(edges[0]))];
+}
+
+static void cop2_op(struct lightrec_state *state, uint32_t op)
+{
+}
+
+static void enable_ram(struct lightrec_state *state, _Bool enable)
+{
+}
+
+static _Bool hw_direct(uint32_t kaddr, _Bool is_write, uint8_t size)
+{
+	hw_direct_calls++;
+
+	return kaddr >= HW_BASE + HW_TEST_AREA && size == 32;
+}
+
+/* The direct accesses must never reach the handlers */
+static void hw_sb(struct lightrec_state *state, uint32_t opcode,
+		  void *host, uint32_t addr, uint32_t data)
+{
+	hw_ops_calls++;
+}
+
+static uint8_t hw_lb(struct lightrec_state *state, uint32_t opcode,
+		     void *host, uint32_t addr)
+{
+	hw_ops_calls++;
+
+	return 0;
+}
+
+static uint16_t hw_lh(struct lightrec_state *state, uint32_t opcode,
+		      void *host, uint32_t addr)
+{
+	hw_ops_calls++;
+
+	return 0;
+}
+
+static uint32_t hw_lw(struct lightrec_state *state, uint32_t opcode,
+		      void *host, uint32_t addr)
+{
+	hw_ops_calls++;
+
+	return 0;
+}
+
+static const struct lightrec_mem_map_ops hw_ops = {
+	.sb = hw_sb,
+	.sh = hw_sb,
+	.sw = hw_sb,
+	.lb = hw_lb,
+	.lh = hw_lh,
+	.lw = hw_lw,
+	.lwu = hw_lw,
+	.swu = hw_sb,
+};
+
+static const struct lightrec_ops ops = {
+	.cop2_op = cop2_op,
+	.enable_ram = enable_ram,
+	.hw_direct = hw_direct,
+};
+
+static void cpu_init(struct cpu *cpu)
+{
+	struct lightrec_mem_map *maps = cpu->maps;
+	unsigned int i;
+
+	cpu->ram = calloc(1, RAM_SIZE);
+	cpu->hw = calloc(1, HW_SIZE);
+
+	maps[PSX_MAP_KERNEL_USER_RAM] = (struct lightrec_mem_map){
+		.pc = 0x00000000, .length = RAM_SIZE, .address = cpu->ram,
+	};
+	maps[PSX_MAP_BIOS] = (struct lightrec_mem_map){
+		.pc = 0x1fc00000, .length = 0x80000, .address = calloc(1, 0x80000),
+	};
+	maps[PSX_MAP_SCRATCH_PAD] = (struct lightrec_mem_map){
+		.pc = 0x1f800000, .length = 0x400, .address = calloc(1, 0x400),
+	};
+	maps[PSX_MAP_PARALLEL_PORT] = (struct lightrec_mem_map){
+		.pc = 0x1f000000, .length = 0x10000, .address = calloc(1, 0x10000),
+	};
+	maps[PSX_MAP_HW_REGISTERS] = (struct lightrec_mem_map){
+		.pc = HW_BASE, .length = HW_SIZE, .address = cpu->hw,
+		.ops = &hw_ops,
+	};
+	maps[PSX_MAP_CACHE_CONTROL] = (struct lightrec_mem_map){
+		.pc = 0x5ffe0130, .length = 4, .address = calloc(1, 4),
+		.ops = &hw_ops,
+	};
+
+	for (i = 0; i < 3; i++) {
+		maps[PSX_MAP_MIRROR1 + i] = (struct lightrec_mem_map){
+			.pc = RAM_SIZE * (i + 1), .length = RAM_SIZE,
+			.address = cpu->ram,
+			.mirror_of = &maps[PSX_MAP_KERNEL_USER_RAM],
+		};
+	}
+
+	cpu->state = lightrec_init("lightrec-partial", maps,
+				   PSX_MAP_CODE_BUFFER, &ops);
+	if (!cpu->state) {
+		fprintf(stderr, "Unable to initialize Lightrec\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void cpu_exit(struct cpu *cpu)
+{
+	unsigned int i;
+
+	lightrec_destroy(cpu->state);
+
+	for (i = 0; i < PSX_MAP_MIRROR1; i++)
+		free(cpu->maps[i].address);
+}
+
+static uint32_t i_type(unsigned int op, unsigned int rs,
+		       unsigned int rt, uint16_t imm)
+{
+	return op << 26 | rs << 21 | rt << 16 | imm;
+}
+
+/*
+ * Writes the block for one access to both CPUs and returns its address:
+ *	lui	$8, %hi(base)
+ *	ori	$8, $8, %lo(base)
+ *	op	rt, imm($8)
+ *	break
+ *	b	.
+ *	nop
+ *
+ * Blocks only end on jumps and branches.
+ */
+static uint32_t write_block(struct cpu *cpus, unsigned int nb, uint32_t base,
+			    unsigned int op, unsigned int rt, int16_t imm)
+{
+	static unsigned int nb_blocks;
+	uint32_t pc = CODE_BASE + nb_blocks++ * 32;
+	uint32_t code[6] = {
+		i_type(0x0f, 0, 8, base >> 16),
+		i_type(0x0d, 8, 8, base & 0xffff),
+		i_type(op, 8, rt, imm),
+		0x0000000d,
+		0x1000ffff,
+		0x00000000,
+	};
+	unsigned int i;
+
+	for (i = 0; i < nb; i++)
+		memcpy(&cpus[i].ram[(pc & (RAM_SIZE - 1)) / 4], code, sizeof(code));
+
+	return pc;
+}
+
+static void run(struct cpu *cpus, uint32_t pc, const char *name,
+		unsigned int align, uint32_t base, unsigned int rt, int16_t imm)
+{
+	struct lightrec_registers *regs, *ref_regs;
+	uint32_t addr = (base + imm) & ~3;
+	unsigned int i, hw_offset = (addr & 0x1fffffff) - HW_BASE;
+	uint32_t mem[4], end, ref_end, flags, ref_flags;
+
+	regs = lightrec_get_registers(cpus[0].state);
+	ref_regs = lightrec_get_registers(cpus[1].state);
+
+	for (i = 0; i < 34; i++)
+		regs->gpr[i] = ref_regs->gpr[i] = random_value();
+	regs->gpr[0] = ref_regs->gpr[0] = 0;
+
+	/* The accessed word and its neighbours */
+	for (i = 0; i < 4; i++)
+		mem[i] = random_value();
+	memcpy(cpus[0].hw + hw_offset - 4, mem, sizeof(mem));
+	memcpy(cpus[1].hw + hw_offset - 4, mem, sizeof(mem));
+
+	lightrec_reset_cycle_count(cpus[0].state, 0);
+	lightrec_reset_cycle_count(cpus[1].state, 0);
+
+	end = lightrec_execute(cpus[0].state, pc, 0x1000);
+	flags = lightrec_exit_flags(cpus[0].state);
+	ref_end = lightrec_run_interpreter(cpus[1].state, pc, 0x1000);
+	ref_flags = lightrec_exit_flags(cpus[1].state);
+
+	if (end != ref_end || flags != ref_flags
+	    || memcmp(regs->gpr, ref_regs->gpr, sizeof(regs->gpr))
+	    || memcmp(cpus[0].hw + hw_offset - 4,
+		      cpus[1].hw + hw_offset - 4, sizeof(mem))) {
+		if (failures < 10) {
+			fprintf(stderr, "%s mismatch: base 0x%08x, imm %d, "
+				"alignment %u, rt $%u: rt 0x%08x/0x%08x, "
+				"word 0x%08x/0x%08x, pc 0x%08x/0x%08x\n",
+				name, base, imm, align, rt, regs->gpr[rt],
+				ref_regs->gpr[rt],
+				*(uint32_t *)(cpus[0].hw + hw_offset),
+				*(uint32_t *)(cpus[1].hw + hw_offset),
+				end, ref_end);
+		}
+
+		failures++;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static const struct {
+		const char *name;
+		unsigned int op;
+	} opcodes[] = {
+		{ "LWL", OP_LWL }, { "LWR", OP_LWR },
+		{ "SWL", OP_SWL }, { "SWR", OP_SWR },
+	};
+	static const uint32_t segments[] = { 0x00000000, 0xa0000000 };
+	unsigned int values = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000;
+	unsigned int i, op, align, seg, variant, rt, nb_blocks = 0;
+	struct cpu cpus[2];
+	uint32_t pc, addr, base;
+	int16_t imm;
+
+	cpu_init(&cpus[0]);
+	cpu_init(&cpus[1]);
+
+	for (op = 0; op < 4; op++)
+	for (align = 0; align < 4; align++)
+	for (seg = 0; seg < 2; seg++)
+	for (variant = 0; variant < 3; variant++)
+	for (rt = 8; rt <= 9; rt++) {
+		addr = segments[seg] + HW_BASE + HW_TEST_AREA
+			+ nb_blocks++ * 16 + align;
+
+		switch (variant) {
+		case 0:
+			/* Aligned base, the offset holds the alignment */
+			base = addr & ~3;
+			imm = align;
+			break;
+		case 1:
+			/* Unaligned base, negative offset */
+			base = addr + 0x100;
+			imm = -0x100;
+			break;
+		default:
+			/* Unaligned base, offset of a few words */
+			base = addr - 12;
+			imm = 12;
+			break;
+		}
+
+		pc = write_block(cpus, 2, base, opcodes[op].op, rt, imm);
+
+		for (i = 0; i < values; i++)
+			run(cpus, pc, opcodes[op].name, align, base, rt, imm);
+	}
+
+	/* Every access was tagged as direct, and the recompiled blocks were
+	 * never interpreted */
+	check(hw_direct_calls > 0);
+	check(hw_ops_calls == 0);
+	check(lightrec_int_op_count(cpus[0].state) == 0);
+
+	cpu_exit(&cpus[0]);
+	cpu_exit(&cpus[1]);
+
+	if (failures)
+		fprintf(stderr, "%u checks failed\n", failures);
+
+	return !!failures;
+}
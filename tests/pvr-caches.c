@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Texture cache invalidation checks for the PVR renderer
+ *
+ * VRAM fills, uploads and copies are sent through gpulib to textures that
+ * are in use. Every time a page is sampled again, its converted texels and
+ * palettes must match a conversion made from scratch out of the VRAM mirror.
+ */
+
+#include "../src/pvr.c"
+
+#include "kos-stubs.h"
+#include "test.h"
+
+#define PAGE_16BPP	5	/* x = 320 */
+#define PAGE_8BPP	12	/* x = 768 */
+#define PAGE_4BPP	10	/* x = 640 */
+#define PAGE_WRAP	15	/* x = 960, lines wrap around the VRAM */
+
+#define CLUT_4BPP	(480 << 6)
+#define CLUT_8BPP	(481 << 6)
+
+static unsigned int failures;
+static uint32_t seed = 0x12345678;
+
+static uint32_t rand32(void)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return seed;
+}
+
+static void gp0(const uint32_t *words, unsigned int nb)
+{
+	GPUwriteDataMem((uint32_t *)words, nb);
+}
+
+static void next_frame(void)
+{
+	hw_render_stop();
+	hw_render_start();
+}
+
+static void vram_upload(unsigned int x, unsigned int y,
+			unsigned int w, unsigned int h)
+{
+	unsigned int i, nb = (w * h + 1) / 2;
+	uint32_t *cmd = malloc((3 + nb) * 4);
+
+	cmd[0] = 0xa0000000;
+	cmd[1] = y << 16 | x;
+	cmd[2] = h << 16 | w;
+
+	for (i = 0; i < nb; i++) {
+		/* Keep some transparent and semi-transparent texels */
+		cmd[3 + i] = (rand32() & 7) ? rand32() : 0;
+	}
+
+	gp0(cmd, 3 + nb);
+	free(cmd);
+}
+
+static void vram_fill(unsigned int x, unsigned int y,
+		      unsigned int w, unsigned int h, uint32_t bgr)
+{
+	const uint32_t cmd[] = { 0x02000000 | bgr, y << 16 | x, h << 16 | w };
+
+	gp0(cmd, 3);
+}
+
+static void vram_copy(unsigned int sx, unsigned int sy,
+		      unsigned int dx, unsigned int dy,
+		      unsigned int w, unsigned int h)
+{
+	const uint32_t cmd[] = {
+		0x80000000, sy << 16 | sx, dy << 16 | dx, h << 16 | w,
+	};
+
+	gp0(cmd, 4);
+}
+
+static void sample_page(unsigned int page, enum texture_bpp bpp,
+			uint16_t clut)
+{
+	const uint32_t cmd[] = {
+		0xe1000000 | bpp << 7 | (page / 16) << 4 | (page % 16),
+		/* Raw textured rectangle, covering the whole page */
+		0x65808080, 0, (uint32_t)clut << 16, 256 << 16 | 256,
+	};
+
+	gp0(cmd, 5);
+}
+
+static void check_page(unsigned int page_offset, enum texture_bpp bpp)
+{
+	struct texture_page *page, *fresh;
+	struct texture_page_4bpp *page4;
+	alignas(32) uint64_t palette[256];
+	unsigned int i, nb;
+	uint32_t sat_mask;
+	uint8_t alpha;
+
+	for (page = pvr.textures[page_offset]; page; page = page->next) {
+		if (page->settings.bpp == bpp)
+			break;
+	}
+
+	check(page != NULL);
+	if (!page)
+		return;
+
+	/* The page was just sampled in full, so no band can be dirty */
+	check(page->dirty == 0);
+
+	fresh = alloc_texture(page->settings);
+	fresh->settings = page->settings;
+	load_texture(fresh, page_offset);
+
+	if (bpp == TEXTURE_16BPP) {
+		check(!memcmp(page->tex, fresh->tex, 256 * 256 * 2));
+		check(!memcmp(to_texture_page_16bpp(page)->mask_tex,
+			      to_texture_page_16bpp(fresh)->mask_tex,
+			      256 * 256 * 2));
+		check(page->alpha == fresh->alpha);
+	} else {
+		check(!memcmp(page->vq->frame, fresh->vq->frame,
+			      sizeof(page->vq->frame)));
+
+		page4 = to_texture_page_4bpp(page);
+		nb = bpp == TEXTURE_4BPP ? 16 : 256;
+
+		for (i = 0; i < page4->nb_cluts; i++) {
+			if (page4->clut[i].stale)
+				continue;
+
+			alpha = load_palette(palette, page4->clut[i].clut,
+					     nb, &sat_mask);
+
+			check(page4->clut[i].alpha == alpha);
+			check(page4->clut[i].sat_mask == sat_mask);
+			check(!memcmp(bpp == TEXTURE_4BPP
+				      ? page->vq->codebook4[i].palette
+				      : page->vq->codebook8[i].palette,
+				      palette, nb * sizeof(*palette)));
+		}
+	}
+
+	pvr_reap_texture(fresh);
+}
+
+static void sample_and_check_all(void)
+{
+	sample_page(PAGE_16BPP, TEXTURE_16BPP, 0);
+	sample_page(PAGE_8BPP, TEXTURE_8BPP, CLUT_8BPP);
+	sample_page(PAGE_4BPP, TEXTURE_4BPP, CLUT_4BPP);
+	sample_page(PAGE_WRAP, TEXTURE_16BPP, 0);
+
+	check_page(PAGE_16BPP, TEXTURE_16BPP);
+	check_page(PAGE_8BPP, TEXTURE_8BPP);
+	check_page(PAGE_4BPP, TEXTURE_4BPP);
+	check_page(PAGE_WRAP, TEXTURE_16BPP);
+}
+
+int main(void)
+{
+	/* Draw area on the displayed 256x240 area at (0, 0), so that the
+	 * checks don't involve render targets. */
+	const uint32_t setup[] = {
+		0xe3000000, 0xe4000000 | 239 << 10 | 255, 0xe5000000,
+	};
+	unsigned int i, in_flight;
+
+	GPUinit();
+	gp0(setup, 3);
+
+	vram_upload(0, 0, 1024, 512);
+	hw_render_start();
+	sample_and_check_all();
+
+	/* Run every write twice: while the pages are still in flight, where
+	 * the written bands are only flagged, and once they are idle, where
+	 * the written area is patched in place. */
+	for (in_flight = 0; in_flight < 2; in_flight++) {
+		for (i = 0; i < 2 * !in_flight; i++)
+			next_frame();
+
+		/* Fills are 16-pixel aligned */
+		vram_fill(320 + 48, 20, 64, 24, 0x123456);
+		vram_fill(768 + 16, 100, 32, 40, 0x000000);
+		vram_fill(640, 250, 64, 12, 0x808080);
+		sample_and_check_all();
+
+		/* Unaligned uploads, across bands */
+		for (i = 0; i < 2 * !in_flight; i++)
+			next_frame();
+
+		vram_upload(320 + 3, 13, 37, 41);
+		vram_upload(768 + 101, 60, 27, 3);
+		vram_upload(640 + 7, 130, 50, 70);
+		sample_and_check_all();
+
+		/* Copies, including from one page to another */
+		for (i = 0; i < 2 * !in_flight; i++)
+			next_frame();
+
+		vram_copy(640 + 5, 0, 320 + 9, 200, 40, 30);
+		vram_copy(0, 300, 768 + 60, 17, 68, 16);
+		vram_copy(320, 0, 640 + 33, 240, 20, 16);
+		sample_and_check_all();
+
+		/* Palettes */
+		for (i = 0; i < 2 * !in_flight; i++)
+			next_frame();
+
+		vram_fill(0, 480, 16, 1, 0x0000f8);
+		vram_upload(100, 481, 40, 1);
+		vram_copy(500, 500, 0, 481, 30, 1);
+		sample_and_check_all();
+
+		/* Writes to the start of the VRAM lines modify the last
+		 * lines of the page that wraps around, one line above. */
+		for (i = 0; i < 2 * !in_flight; i++)
+			next_frame();
+
+		vram_fill(0, 16, 32, 1, 0xffffff);
+		vram_upload(150, 255, 20, 2);
+		vram_copy(320, 100, 64, 31, 16, 2);
+		sample_and_check_all();
+	}
+
+	hw_render_stop();
+
+	check(pvr_stub.errors == 0);
+
+	if (failures)
+		fprintf(stderr, "%u checks failed\n", failures);
+
+	return !!failures;
+}
@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Render target checks for the PVR renderer
+ *
+ * A double-buffered game draws each frame to the buffer that is not
+ * displayed; that frame must still go to the main scene. Draws to other
+ * areas go to render targets, which start from the area's current content.
+ */
+
+#include "../src/pvr.c"
+
+#include "kos-stubs.h"
+#include "test.h"
+
+/* Off-screen area, used as a 16bpp texture */
+#define RT_X	512
+#define RT_Y	0
+#define RT_W	128
+#define RT_H	64
+
+static unsigned int failures;
+
+static void gp0(const uint32_t *words, unsigned int nb)
+{
+	GPUwriteDataMem((uint32_t *)words, nb);
+}
+
+static void set_draw_area(unsigned int x, unsigned int y,
+			  unsigned int w, unsigned int h)
+{
+	const uint32_t cmd[] = {
+		0xe3000000 | y << 10 | x,
+		0xe4000000 | (y + h - 1) << 10 | (x + w - 1),
+		0xe5000000 | y << 11 | x,
+	};
+
+	gp0(cmd, 3);
+}
+
+static void draw_frame(unsigned int y, bool use_rt)
+{
+	const uint32_t clear[] = { 0x02000000, y << 16, 240 << 16 | 256 };
+	const uint32_t rect[] = { 0x60ff0000, 16 << 16 | 16, 64 << 16 | 64 };
+	const uint32_t textured[] = {
+		0xe1000000 | (RT_X / 64),
+		0x65808080, 100 << 16 | 100, 0, RT_H << 16 | RT_W,
+	};
+	const uint32_t rt_fill[] = {
+		0x02ffffff, (RT_Y + 16) << 16 | RT_X, 16 << 16 | 32,
+	};
+
+	if (use_rt) {
+		/* Render to the off-screen area first... */
+		set_draw_area(RT_X, RT_Y, RT_W, RT_H);
+		gp0(rt_fill, 3);
+		gp0(rect, 3);
+	}
+
+	set_draw_area(0, y, 256, 240);
+	gp0(clear, 3);
+	gp0(rect, 3);
+
+	/* ...and sample it from the frame */
+	if (use_rt)
+		gp0(textured, 5);
+}
+
+static void flip(unsigned int y)
+{
+	hw_render_stop();
+	GPUwriteStatus(0x05000000 | y << 10);
+	hw_render_start();
+}
+
+static void vram_upload(unsigned int x, unsigned int y,
+			unsigned int w, unsigned int h)
+{
+	unsigned int i, nb = (w * h + 1) / 2;
+	uint32_t *cmd = malloc((3 + nb) * 4);
+
+	cmd[0] = 0xa0000000;
+	cmd[1] = y << 16 | x;
+	cmd[2] = h << 16 | w;
+
+	for (i = 0; i < nb; i++)
+		cmd[3 + i] = (i & 3) ? i * 0x9e3779b1 : 0;
+
+	gp0(cmd, 3 + nb);
+	free(cmd);
+}
+
+static void check_seed(const struct render_target *rt)
+{
+	const uint16_t *seed = rt->seed, *src;
+	unsigned int x, y;
+	uint16_t px;
+
+	for (y = 0; y < rt->h; y++) {
+		src = &gpu.vram[(rt->y + y) * 1024 + rt->x];
+
+		for (x = 0; x < rt->w; x++) {
+			/* The mirror was filled after the seed was loaded */
+			if (x < 32 && y >= 16 && y < 32)
+				continue;
+
+			px = src[x] ? bgr_to_rgb(src[x]) | 0x8000 : 0;
+
+			if (seed[y * rt->tex_w + x] != px) {
+				check(seed[y * rt->tex_w + x] == px);
+				return;
+			}
+		}
+	}
+}
+
+static void check_double_buffering(bool use_rt)
+{
+	unsigned int frame, scenes, txr_scenes, finished, fb_writes;
+	unsigned int back = 240;
+
+	pvr_stub_reset();
+
+	/* The game displayed the second buffer, then flipped to the first
+	 * one; it now draws to the second one. */
+	GPUwriteStatus(0x05000000 | 240 << 10);
+	GPUwriteStatus(0x05000000);
+	hw_render_start();
+
+	for (frame = 0; frame < 8; frame++) {
+		scenes = pvr_stub.scenes;
+		txr_scenes = pvr_stub.txr_scenes;
+		finished = pvr_stub.scenes_finished;
+		fb_writes = pvr_stub.fb_cfg_writes;
+
+		draw_frame(back, use_rt);
+		flip(back);
+		back ^= 240;
+
+		/* The frame was rendered and displayed, along with the
+		 * render target if any. */
+		check(pvr_stub.scenes - pvr_stub.txr_scenes
+		      == scenes - txr_scenes + 1);
+		check(pvr_stub.txr_scenes == txr_scenes + use_rt);
+		check(pvr_stub.scenes_finished == pvr_stub.scenes);
+		check(pvr_stub.scenes_finished == finished + 1 + use_rt);
+
+		/* The framebuffer format only changes for render targets,
+		 * when their scene and the main one are finished. */
+		check(pvr_stub.fb_cfg_writes == fb_writes + 2 * use_rt);
+	}
+
+	hw_render_stop();
+	check(pvr_stub.errors == 0);
+}
+
+static struct render_target * find_rt(void)
+{
+	struct render_target *rt;
+	unsigned int i;
+
+	for (i = 0; i < NB_RENDER_TARGETS; i++) {
+		rt = &pvr.render_targets[i];
+
+		if (rt->tex && rt->x == RT_X && rt->y == RT_Y
+		    && rt->w == RT_W && rt->h == RT_H)
+			return rt;
+	}
+
+	return NULL;
+}
+
+static void check_render_target_seed(void)
+{
+	struct render_target *rt;
+	pvr_ptr_t tex;
+
+	pvr_stub_reset();
+	GPUwriteStatus(0x05000000 | 240 << 10);
+	GPUwriteStatus(0x05000000);
+	hw_render_start();
+
+	/* The area was written by the CPU: the render target starts from
+	 * the VRAM mirror. */
+	vram_upload(RT_X, RT_Y, RT_W, RT_H);
+	draw_frame(240, true);
+
+	rt = find_rt();
+	check(rt != NULL);
+	if (!rt)
+		return;
+
+	check_seed(rt);
+	flip(240);
+
+	/* Nothing wrote to it since: the last render is the background */
+	check(rt->valid);
+	tex = rt->tex;
+	draw_frame(0, true);
+	check(rt->seed == tex);
+	flip(0);
+
+	/* Written again, partially */
+	check(rt->valid);
+	vram_upload(RT_X + 16, RT_Y + 8, 32, 4);
+	check(!rt->valid);
+	draw_frame(240, true);
+	check_seed(rt);
+	flip(240);
+
+	hw_render_stop();
+	check(pvr_stub.errors == 0);
+}
+
+int main(void)
+{
+	GPUinit();
+
+	check_double_buffering(false);
+	check_double_buffering(true);
+	check_render_target_seed();
+
+	if (failures)
+		fprintf(stderr, "%u checks failed\n", failures);
+
+	return !!failures;
+}
@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * ADPCM block cache checks for the dfsound SPU plugin
+ *
+ * Looping voices are decoded through decode_block_cached() while SPU RAM
+ * is modified by DMA and data port writes, savestate loads and the reverb
+ * work area. Every decoded block must match a decode of the current SPU
+ * RAM contents.
+ *
+ * Usage: spu-adpcm-cache [steps]
+ */
+
+#include <stdbool.h>
+
+#include <dfsound/spu.c>
+
+#include "test.h"
+
+#define SPU_RAM_SIZE	0x80000
+#define NB_VOICES	24
+
+static unsigned int failures;
+static uint32_t seed = 0x1b873593;
+
+static struct voice {
+	unsigned int loop, nb_blocks, block;
+	int SB[28], ref_SB[28];
+} voices[NB_VOICES];
+
+static uint32_t rand32(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+
+	return seed;
+}
+
+static void random_ram(unsigned int addr, unsigned int len)
+{
+	unsigned int i;
+
+	for (i = 0; i < len; i++)
+		spu.spuMemC[(addr + i) & (SPU_RAM_SIZE - 1)] = rand32();
+}
+
+static void random_voice(struct voice *v)
+{
+	v->nb_blocks = 1 + rand32() % 8;
+	v->loop = (rand32() % (SPU_RAM_SIZE / 16 - v->nb_blocks)) * 16;
+	v->block = 0;
+
+	memset(v->SB, 0, sizeof(v->SB));
+	memset(v->ref_SB, 0, sizeof(v->ref_SB));
+}
+
+static bool in_cache(unsigned int addr, int s_1, int s_2)
+{
+	unsigned int i;
+
+	for (i = 0; i < ADPCM_CACHE_SIZE; i++) {
+		if (adpcm_cache[i].addr == addr && adpcm_cache[i].s_1 == s_1
+		    && adpcm_cache[i].s_2 == s_2)
+			return true;
+	}
+
+	return false;
+}
+
+/* Returns true if the block came from the cache */
+static bool decode_voice(struct voice *v)
+{
+	unsigned int addr = v->loop + v->block * 16;
+	const unsigned char *start = spu.spuMemC + addr;
+	int predict_nr = start[0] >> 4, shift_factor = start[0] & 0xf;
+	bool hit, history = predict_nr >= 1 && predict_nr <= 4;
+
+	hit = in_cache(addr, history ? v->SB[27] : 0, history ? v->SB[26] : 0);
+
+	decode_block_cached(v->SB, start);
+	decode_block_data(v->ref_SB, start + 2, predict_nr, shift_factor);
+
+	if (memcmp(v->SB, v->ref_SB, sizeof(v->SB))) {
+		if (failures < 10) {
+			fprintf(stderr, "Block 0x%05x mismatch, filter %d, %s\n",
+				addr, predict_nr, hit ? "cached" : "decoded");
+		}
+
+		failures++;
+	}
+
+	if (++v->block == v->nb_blocks) {
+		v->block = 0;
+
+		/* Voices keyed on again start without history */
+		if (rand32() & 1) {
+			memset(v->SB, 0, sizeof(v->SB));
+			memset(v->ref_SB, 0, sizeof(v->ref_SB));
+		}
+	}
+
+	return hit;
+}
+
+/* Writes land on a voice's samples most of the time */
+static unsigned int random_write_addr(void)
+{
+	const struct voice *v = &voices[rand32() % NB_VOICES];
+
+	if (rand32() & 3)
+		return (v->loop + rand32() % (v->nb_blocks * 16 + 32) - 16)
+			& (SPU_RAM_SIZE - 2);
+
+	return rand32() & (SPU_RAM_SIZE - 2);
+}
+
+static void dma_write(void)
+{
+	unsigned short data[64];
+	unsigned int i, nb = 1 + rand32() % 64;
+
+	for (i = 0; i < nb; i++)
+		data[i] = rand32();
+
+	spu.spuAddr = random_write_addr();
+	SPUwriteDMAMem(data, nb, 0);
+}
+
+static void port_write(void)
+{
+	unsigned int i, nb = 1 + rand32() % 8;
+
+	/* The address register is in 8-byte units */
+	SPUwriteRegister(H_SPUaddr, random_write_addr() >> 3, 0);
+
+	for (i = 0; i < nb; i++)
+		SPUwriteRegister(H_SPUdata, rand32(), 0);
+}
+
+static void reverb_write(void)
+{
+	unsigned int start = spu.rvb->StartAddr * 2;
+
+	/* The reverb mixer writes its work area without invalidating */
+	if (start)
+		random_ram(start + rand32() % (SPU_RAM_SIZE - start), 8);
+}
+
+static void reverb_move(void)
+{
+	/* Work areas of up to 128 KiB at the end of SPU RAM; the cache
+	 * stops at the lowest start address seen. */
+	spu.rvb->StartAddr = 0x40000 - (1 + rand32() % 0x4000) * 4;
+
+	adpcm_cache_reverb_on();
+}
+
+static void savestate_load(void)
+{
+	random_ram(0, SPU_RAM_SIZE);
+	adpcm_cache_invalidate(0, SPU_RAM_SIZE);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i, r, steps = argc > 1 ? strtoul(argv[1], NULL, 0) : 500000;
+	unsigned int decodes = 0, hits = 0;
+
+	SPUinit();
+	random_ram(0, SPU_RAM_SIZE);
+
+	for (i = 0; i < NB_VOICES; i++)
+		random_voice(&voices[i]);
+
+	for (i = 0; i < steps; i++) {
+		r = rand32() % 1000;
+
+		if (r < 50)
+			dma_write();
+		else if (r < 100)
+			port_write();
+		else if (r < 102)
+			reverb_move();
+		else if (r < 105)
+			random_voice(&voices[rand32() % NB_VOICES]);
+		else if (r == 105 && !(rand32() & 15))
+			savestate_load();
+		else {
+			hits += decode_voice(&voices[rand32() % NB_VOICES]);
+			decodes++;
+		}
+
+		reverb_write();
+	}
+
+	/* Enough blocks must have come from the cache for this to mean
+	 * anything */
+	check(hits > decodes / 4);
+
+	if (failures)
+		fprintf(stderr, "%u checks failed\n", failures);
+
+	return !!failures;
+}
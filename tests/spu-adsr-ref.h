@@ -0,0 +1,285 @@
+/*
+ * Reference ADSR implementation for the spu-adsr test: MixADSR() and
+ * SkipADSR() as they were before the linear segments were evaluated in
+ * bulk, one sample at a time. Included from spu-adsr.c after spu.c.
+ *
+ * Copyright (C) 2002 by Pete Bernert, GPL-2.0-or-later (see adsr.c)
+ */
+
+static int RefMixADSR(int *samples, ADSRInfoEx *adsr, int ns_to)
+{
+ unsigned int EnvelopeVol = adsr->EnvelopeVol;
+ int ns = 0, val, rto, level;
+
+ if (adsr->State == ADSR_RELEASE)
+ {
+   val = RateTableSub[adsr->ReleaseRate * 4];
+
+   if (adsr->ReleaseModeExp)
+   {
+     for (; ns < ns_to; ns++)
+     {
+       EnvelopeVol += ((long long)val * EnvelopeVol) >> (15+16);
+       if ((signed int)EnvelopeVol <= 0)
+         break;
+
+       samples[ns] *= (signed int)EnvelopeVol >> 21;
+       samples[ns] >>= 10;
+     }
+   }
+   else
+   {
+     for (; ns < ns_to; ns++)
+     {
+       EnvelopeVol += val;
+       if ((signed int)EnvelopeVol <= 0)
+         break;
+
+       samples[ns] *= (signed int)EnvelopeVol >> 21;
+       samples[ns] >>= 10;
+     }
+   }
+
+   goto done;
+ }
+
+ switch (adsr->State)
+ {
+   case ADSR_ATTACK:                                   // -> attack
+     rto = 0;
+     if (adsr->AttackModeExp && EnvelopeVol >= 0x60000000)
+       rto = 8;
+     val = RateTableAdd[adsr->AttackRate + rto];
+
+     for (; ns < ns_to; ns++)
+     {
+       EnvelopeVol += val;
+       if ((signed int)EnvelopeVol < 0) // overflow
+        break;
+
+       samples[ns] *= (signed int)EnvelopeVol >> 21;
+       samples[ns] >>= 10;
+     }
+
+     if ((signed int)EnvelopeVol < 0) // overflow
+     {
+       EnvelopeVol = 0x7fffffff;
+       adsr->State = ADSR_DECAY;
+       ns++; // sample is good already
+       goto decay;
+     }
+     break;
+
+   //--------------------------------------------------//
+   decay:
+   case ADSR_DECAY:                                    // -> decay
+     val = RateTableSub[adsr->DecayRate * 4];
+     level = adsr->SustainLevel;
+
+     for (; ns < ns_to; )
+     {
+       EnvelopeVol += ((long long)val * EnvelopeVol) >> (15+16);
+       if ((signed int)EnvelopeVol < 0)
+         EnvelopeVol = 0;
+
+       samples[ns] *= EnvelopeVol >> 21;
+       samples[ns] >>= 10;
+       ns++;
+
+       if (((EnvelopeVol >> 27) & 0xf) <= level)
+       {
+         adsr->State = ADSR_SUSTAIN;
+         goto sustain;
+       }
+     }
+     break;
+
+   //--------------------------------------------------//
+   sustain:
+   case ADSR_SUSTAIN:                                  // -> sustain
+     if (adsr->SustainIncrease)
+     {
+       if (EnvelopeVol >= 0x7fff0000)
+       {
+         ns = ns_to;
+         break;
+       }
+
+       rto = 0;
+       if (adsr->SustainModeExp && EnvelopeVol >= 0x60000000)
+         rto = 8;
+       val = RateTableAdd[adsr->SustainRate + rto];
+
+       for (; ns < ns_to; ns++)
+       {
+         EnvelopeVol += val;
+         if (EnvelopeVol >= 0x7fe00000)
+         {
+           EnvelopeVol = 0x7fffffff;
+           ns = ns_to;
+           break;
+         }
+
+         samples[ns] *= (signed int)EnvelopeVol >> 21;
+         samples[ns] >>= 10;
+       }
+     }
+     else
+     {
+       val = RateTableSub[adsr->SustainRate];
+       if (adsr->SustainModeExp)
+       {
+         for (; ns < ns_to; ns++)
+         {
+           EnvelopeVol += ((long long)val * EnvelopeVol) >> (15+16);
+           if ((signed int)EnvelopeVol < 0)
+             break;
+
+           samples[ns] *= (signed int)EnvelopeVol >> 21;
+           samples[ns] >>= 10;
+         }
+       }
+       else
+       {
+         for (; ns < ns_to; ns++)
+         {
+           EnvelopeVol += val;
+           if ((signed int)EnvelopeVol < 0)
+             break;
+
+           samples[ns] *= (signed int)EnvelopeVol >> 21;
+           samples[ns] >>= 10;
+         }
+       }
+     }
+     break;
+ }
+
+done:
+ adsr->EnvelopeVol = EnvelopeVol;
+ return ns;
+}
+
+static int RefSkipADSR(ADSRInfoEx *adsr, int ns_to)
+{
+ unsigned int EnvelopeVol = adsr->EnvelopeVol;
+ int ns = 0, val, rto, level;
+ int64_t v64;
+
+ if (adsr->State == ADSR_RELEASE)
+ {
+   val = RateTableSub[adsr->ReleaseRate * 4];
+   if (adsr->ReleaseModeExp)
+   {
+     for (; ns < ns_to; ns++)
+     {
+       EnvelopeVol += ((long long)val * EnvelopeVol) >> (15+16);
+       if ((signed int)EnvelopeVol <= 0)
+         break;
+     }
+   }
+   else
+   {
+     v64 = EnvelopeVol;
+     v64 += (int64_t)val * ns_to;
+     EnvelopeVol = (int)v64;
+     if (v64 > 0)
+       ns = ns_to;
+   }
+   goto done;
+ }
+
+ switch (adsr->State)
+ {
+   case ADSR_ATTACK:                                   // -> attack
+     rto = 0;
+     if (adsr->AttackModeExp && EnvelopeVol >= 0x60000000)
+       rto = 8;
+     val = RateTableAdd[adsr->AttackRate + rto];
+
+     for (; ns < ns_to; ns++)
+     {
+       EnvelopeVol += val;
+       if ((signed int)EnvelopeVol < 0)
+        break;
+     }
+     if ((signed int)EnvelopeVol < 0) // overflow
+     {
+       EnvelopeVol = 0x7fffffff;
+       adsr->State = ADSR_DECAY;
+       ns++;
+       goto decay;
+     }
+     break;
+
+   //--------------------------------------------------//
+   decay:
+   case ADSR_DECAY:                                    // -> decay
+     val = RateTableSub[adsr->DecayRate * 4];
+     level = adsr->SustainLevel;
+
+     for (; ns < ns_to; )
+     {
+       EnvelopeVol += ((long long)val * EnvelopeVol) >> (15+16);
+       if ((signed int)EnvelopeVol < 0)
+         EnvelopeVol = 0;
+
+       ns++;
+
+       if (((EnvelopeVol >> 27) & 0xf) <= level)
+       {
+         adsr->State = ADSR_SUSTAIN;
+         goto sustain;
+       }
+     }
+     break;
+
+   //--------------------------------------------------//
+   sustain:
+   case ADSR_SUSTAIN:                                  // -> sustain
+     if (adsr->SustainIncrease)
+     {
+       ns = ns_to;
+
+       if (EnvelopeVol >= 0x7fff0000)
+         break;
+
+       rto = 0;
+       if (adsr->SustainModeExp && EnvelopeVol >= 0x60000000)
+         rto = 8;
+       val = RateTableAdd[adsr->SustainRate + rto];
+
+       v64 = EnvelopeVol;
+       v64 += (int64_t)val * (ns_to - ns);
+       EnvelopeVol = (int)v64;
+       if (v64 >= 0x7fe00000ll)
+         EnvelopeVol = 0x7fffffff;
+     }
+     else
+     {
+       val = RateTableSub[adsr->SustainRate];
+       if (adsr->SustainModeExp)
+       {
+         for (; ns < ns_to; ns++)
+         {
+           EnvelopeVol += ((long long)val * EnvelopeVol) >> (15+16);
+           if ((signed int)EnvelopeVol < 0)
+             break;
+         }
+       }
+       else
+       {
+         v64 = EnvelopeVol;
+         v64 += (int64_t)val * (ns_to - ns);
+         EnvelopeVol = (int)v64;
+         if (v64 > 0)
+           ns = ns_to;
+       }
+     }
+     break;
+ }
+
+done:
+ adsr->EnvelopeVol = EnvelopeVol;
+ return ns;
+}
@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * ADSR envelope checks for the dfsound SPU plugin
+ *
+ * MixADSR() and SkipADSR() evaluate linear segments in bulk. Compare them
+ * with the reference, sample by sample implementation over random envelope
+ * states and buffer sizes: the samples, the number of samples played, the
+ * envelope volume and the state must be identical.
+ *
+ * Usage: spu-adsr [iterations]
+ */
+
+#include <stdbool.h>
+
+#include <dfsound/spu.c>
+
+#include "spu-adsr-ref.h"
+#include "test.h"
+
+static unsigned int failures;
+static uint32_t seed = 0x2545f491;
+
+static uint32_t rand32(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+
+	return seed;
+}
+
+static int random_envelope(void)
+{
+	static const int edges[] = {
+		0, 1, 0x7fffffff, 0x7fe00000, 0x7fdfffff, 0x7fff0000,
+		0x7ffeffff, 0x60000000, 0x5fffffff, 0x00200000, 0x001fffff,
+	};
+	uint32_t r = rand32();
+
+	switch (r & 3) {
+	case 0:
+		return edges[(r >> 2) % (sizeof(edges) / sizeof(edges[0]))];
+	case 1:
+		/* Close to the top */
+		return 0x7fffffff - (rand32() & 0xfffff);
+	case 2:
+		/* Close to zero */
+		return rand32() & 0xfffff;
+	default:
+		return rand32() & 0x7fffffff;
+	}
+}
+
+static void random_adsr(ADSRInfoEx *adsr)
+{
+	adsr->State = rand32() & 3;
+	adsr->AttackModeExp = rand32() & 1;
+	adsr->SustainModeExp = rand32() & 1;
+	adsr->SustainIncrease = rand32() & 1;
+	adsr->ReleaseModeExp = rand32() & 1;
+
+	/* The exponential modes use the rate + 8 */
+	adsr->AttackRate = rand32() % 120;
+	adsr->DecayRate = rand32() & 0xf;
+	adsr->SustainLevel = rand32() & 0xf;
+	adsr->SustainRate = rand32() % 120;
+	adsr->ReleaseRate = rand32() & 0x1f;
+	adsr->EnvelopeVol = random_envelope();
+}
+
+static void compare(const ADSRInfoEx *adsr, int ns_to, bool skip)
+{
+	static int samples[NSSIZE], ref_samples[NSSIZE];
+	ADSRInfoEx new_adsr = *adsr, ref_adsr = *adsr;
+	int i, ns, ref_ns;
+
+	for (i = 0; i < ns_to; i++)
+		samples[i] = ref_samples[i] = (int16_t)rand32();
+
+	if (skip) {
+		ns = SkipADSR(&new_adsr, ns_to);
+		ref_ns = RefSkipADSR(&ref_adsr, ns_to);
+	} else {
+		ns = MixADSR(samples, &new_adsr, ns_to);
+		ref_ns = RefMixADSR(ref_samples, &ref_adsr, ns_to);
+	}
+
+	if (ns != ref_ns || new_adsr.EnvelopeVol != ref_adsr.EnvelopeVol
+	    || new_adsr.State != ref_adsr.State
+	    || memcmp(samples, ref_samples, ns_to * sizeof(*samples))) {
+		if (failures < 10) {
+			fprintf(stderr, "%s mismatch: state %u rates %u/%u/%u/%u/%u "
+				"modes %u%u%u%u vol 0x%08x, %d samples: "
+				"%d/%d samples, vol 0x%08x/0x%08x\n",
+				skip ? "SkipADSR" : "MixADSR", adsr->State,
+				adsr->AttackRate, adsr->DecayRate,
+				adsr->SustainLevel, adsr->SustainRate,
+				adsr->ReleaseRate, adsr->AttackModeExp,
+				adsr->SustainModeExp, adsr->SustainIncrease,
+				adsr->ReleaseModeExp, adsr->EnvelopeVol, ns_to,
+				ns, ref_ns, new_adsr.EnvelopeVol,
+				ref_adsr.EnvelopeVol);
+		}
+
+		failures++;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i, iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 200000;
+	ADSRInfoEx adsr;
+	int samples[4];
+
+	InitADSR();
+
+	for (i = 0; i < iterations; i++) {
+		random_adsr(&adsr);
+		compare(&adsr, 1 + rand32() % NSSIZE, i & 1);
+	}
+
+	/* The release rate 31 is too slow to move the volume at all: a voice
+	 * that is already silent must stop right away. */
+	memset(&adsr, 0, sizeof(adsr));
+	adsr.State = ADSR_RELEASE;
+	adsr.ReleaseRate = 31;
+	check(RateTableSub[adsr.ReleaseRate * 4] == 0);
+	check(MixADSR(samples, &adsr, 4) == 0);
+
+	if (failures)
+		fprintf(stderr, "%u checks failed\n", failures);
+
+	return !!failures;
+}
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Voice renderer checks for the dfsound SPU plugin
+ *
+ * do_samples_adpcm() picks a specialised renderer for integer steps and
+ * upsampling. Compare it with the generic renderer of each interpolation
+ * mode over random pitches, positions, interpolation states and decoded
+ * blocks: the output, the returned stop position, spos/sbpos and the
+ * whole sample buffer must be identical.
+ *
+ * Usage: spu-interp [iterations]
+ */
+
+#include <stdbool.h>
+
+#include <dfsound/spu.c>
+
+#include "test.h"
+
+static unsigned int failures;
+static uint32_t seed = 0x85ebca6b;
+
+/* Replays the same blocks for both renderers */
+struct block_source {
+	uint32_t seed;
+};
+
+static uint32_t xorshift(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+static uint32_t rand32(void)
+{
+	return xorshift(&seed);
+}
+
+static int decode_random(void *context, int ch, int *SB)
+{
+	struct block_source *src = context;
+	unsigned int i;
+
+	for (i = 0; i < 28; i++)
+		SB[i] = (int16_t)xorshift(&src->seed);
+
+	/* Ends the voice now and then */
+	return !(xorshift(&src->seed) & 15);
+}
+
+static int random_sinc(void)
+{
+	switch (rand32() & 3) {
+	case 0:
+		/* Integer steps, up to the highest pitch (0x3fff << 4) */
+		return (1 + rand32() % 3) << 16;
+	case 1:
+		return 1 + rand32() % 0xffff;
+	case 2:
+		/* Common upsampling ratios */
+		return 0x10000 >> (1 + rand32() % 3);
+	default:
+		return 1 + rand32() % 0x3fff0;
+	}
+}
+
+static void random_sample_buf(sample_buf *sb, int interp)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(sb->SB) / sizeof(sb->SB[0]); i++)
+		sb->SB[i] = (int16_t)rand32();
+
+	if (interp == 1) {
+		/* The simple interpolation's flag */
+		sb->SB[32] = rand32() % 3;
+		if (rand32() & 1)
+			sb->sinc_old = 0;
+	} else {
+		sb->interp.gauss.pos = rand32() & 3;
+	}
+}
+
+static int generic(int interp, int *dst, void *ctx, int ns_to,
+		   sample_buf *sb, int sinc, int *spos, int *sbpos)
+{
+	switch (interp) {
+	case 0:
+		return do_samples_nointerp(dst, decode_random, ctx, 0, ns_to,
+					   sb, sinc, spos, sbpos);
+	case 1:
+		return do_samples_simple(dst, decode_random, ctx, 0, ns_to,
+					 sb, sinc, spos, sbpos);
+	case 3:
+		return do_samples_cubic(dst, decode_random, ctx, 0, ns_to,
+					sb, sinc, spos, sbpos);
+	default:
+		return do_samples_gauss(dst, decode_random, ctx, 0, ns_to,
+					sb, sinc, spos, sbpos);
+	}
+}
+
+static void compare(int interp)
+{
+	static int dst[NSSIZE], ref_dst[NSSIZE];
+	struct block_source src, ref_src;
+	sample_buf sb, ref_sb;
+	int ret, ref_ret, ns_to, sinc, spos, ref_spos, sbpos, ref_sbpos;
+
+	sinc = random_sinc();
+	ns_to = 1 + rand32() % NSSIZE;
+	random_sample_buf(&sb, interp);
+	ref_sb = sb;
+
+	/* Voices start with spos 0x10000 and an empty buffer */
+	if (rand32() & 7) {
+		spos = rand32() & 0xffff;
+		sbpos = rand32() % 28;
+	} else {
+		spos = 0x10000;
+		sbpos = 28;
+	}
+
+	ref_spos = spos;
+	ref_sbpos = sbpos;
+	src.seed = ref_src.seed = rand32() | 1;
+
+	spu.interpolation = interp;
+	ret = do_samples_adpcm(dst, decode_random, &src, 0, ns_to, 0,
+			       &sb, sinc, &spos, &sbpos);
+	ref_ret = generic(interp, ref_dst, &ref_src, ns_to,
+			  &ref_sb, sinc, &ref_spos, &ref_sbpos);
+
+	if (ret != ref_ret || spos != ref_spos || sbpos != ref_sbpos
+	    || src.seed != ref_src.seed
+	    || memcmp(&sb, &ref_sb, sizeof(sb))
+	    || memcmp(dst, ref_dst, ns_to * sizeof(*dst))) {
+		if (failures < 10) {
+			fprintf(stderr, "Mismatch: interpolation %d, sinc 0x%05x, "
+				"%d samples: returned %d/%d, spos 0x%x/0x%x, "
+				"sbpos %d/%d\n", interp, sinc, ns_to, ret,
+				ref_ret, spos, ref_spos, sbpos, ref_sbpos);
+		}
+
+		failures++;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i, iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+
+	for (i = 0; i < iterations; i++)
+		compare(i & 3);
+
+	if (failures)
+		fprintf(stderr, "%u checks failed\n", failures);
+
+	return !!failures;
+}
@@ -0,0 +1,136 @@
+/*
+ * Reference reverb mixers for the spu-reverb test: MixREVERB() and
+ * MixREVERB_off() as they were before they were split in wrap-free runs,
+ * resolving every tap address for every sample. Included from
+ * spu-reverb.c after spu.c.
+ *
+ * Copyright (C) 2002 by Pete Bernert, GPL-2.0-or-later (see reverb.c)
+ * Portions (C) SPU2-X, gigaherz, Pcsx2 Development Team
+ */
+
+// get_buffer content helper: takes care about wraps
+#define ref_g_buffer(var) \
+ ((int)(signed short)LE16TOH(spu.spuMem[rvb2ram_offs(curr_addr, space, rvb->var)]))
+
+// saturate iVal and store it as var
+#define ref_s_buffer(var, iVal) \
+ ssat32_to_16(iVal); \
+ spu.spuMem[rvb2ram_offs(curr_addr, space, rvb->var)] = HTOLE16(iVal)
+
+#define ref_s_buffer1(var, iVal) \
+ ssat32_to_16(iVal); \
+ spu.spuMem[rvb2ram_offs(curr_addr, space, rvb->var + 1)] = HTOLE16(iVal)
+
+////////////////////////////////////////////////////////////////////////
+
+// portions based on spu2-x from PCSX2
+static void RefMixREVERB(int *SSumLR, int *RVB, int ns_to, int curr_addr)
+{
+ const REVERBInfo *rvb = spu.rvb;
+ int IIR_ALPHA = rvb->IIR_ALPHA;
+ int IIR_COEF = rvb->IIR_COEF;
+ int space = 0x40000 - rvb->StartAddr;
+ int l, r, ns;
+
+ for (ns = 0; ns < ns_to * 2; )
+  {
+   int ACC0, ACC1, FB_A0, FB_A1, FB_B0, FB_B1;
+   int mix_dest_a0, mix_dest_a1, mix_dest_b0, mix_dest_b1;
+
+   int input_L = RVB[ns]   * rvb->IN_COEF_L;
+   int input_R = RVB[ns+1] * rvb->IN_COEF_R;
+
+   int IIR_INPUT_A0 = ((ref_g_buffer(IIR_SRC_A0) * IIR_COEF) + input_L) >> 15;
+   int IIR_INPUT_A1 = ((ref_g_buffer(IIR_SRC_A1) * IIR_COEF) + input_R) >> 15;
+   int IIR_INPUT_B0 = ((ref_g_buffer(IIR_SRC_B0) * IIR_COEF) + input_L) >> 15;
+   int IIR_INPUT_B1 = ((ref_g_buffer(IIR_SRC_B1) * IIR_COEF) + input_R) >> 15;
+
+   int iir_dest_a0 = ref_g_buffer(IIR_DEST_A0);
+   int iir_dest_a1 = ref_g_buffer(IIR_DEST_A1);
+   int iir_dest_b0 = ref_g_buffer(IIR_DEST_B0);
+   int iir_dest_b1 = ref_g_buffer(IIR_DEST_B1);
+
+   int IIR_A0 = iir_dest_a0 + ((IIR_INPUT_A0 - iir_dest_a0) * IIR_ALPHA >> 15);
+   int IIR_A1 = iir_dest_a1 + ((IIR_INPUT_A1 - iir_dest_a1) * IIR_ALPHA >> 15);
+   int IIR_B0 = iir_dest_b0 + ((IIR_INPUT_B0 - iir_dest_b0) * IIR_ALPHA >> 15);
+   int IIR_B1 = iir_dest_b1 + ((IIR_INPUT_B1 - iir_dest_b1) * IIR_ALPHA >> 15);
+
+   preload(SSumLR + ns + 64*2/4 - 4);
+
+   ref_s_buffer1(IIR_DEST_A0, IIR_A0);
+   ref_s_buffer1(IIR_DEST_A1, IIR_A1);
+   ref_s_buffer1(IIR_DEST_B0, IIR_B0);
+   ref_s_buffer1(IIR_DEST_B1, IIR_B1);
+
+   preload(RVB + ns + 64*2/4 - 4);
+
+   ACC0 = (ref_g_buffer(ACC_SRC_A0) * rvb->ACC_COEF_A +
+           ref_g_buffer(ACC_SRC_B0) * rvb->ACC_COEF_B +
+           ref_g_buffer(ACC_SRC_C0) * rvb->ACC_COEF_C +
+           ref_g_buffer(ACC_SRC_D0) * rvb->ACC_COEF_D) >> 15;
+   ACC1 = (ref_g_buffer(ACC_SRC_A1) * rvb->ACC_COEF_A +
+           ref_g_buffer(ACC_SRC_B1) * rvb->ACC_COEF_B +
+           ref_g_buffer(ACC_SRC_C1) * rvb->ACC_COEF_C +
+           ref_g_buffer(ACC_SRC_D1) * rvb->ACC_COEF_D) >> 15;
+
+   FB_A0 = ref_g_buffer(FB_SRC_A0);
+   FB_A1 = ref_g_buffer(FB_SRC_A1);
+   FB_B0 = ref_g_buffer(FB_SRC_B0);
+   FB_B1 = ref_g_buffer(FB_SRC_B1);
+
+   mix_dest_a0 = ACC0 - ((FB_A0 * rvb->FB_ALPHA) >> 15);
+   mix_dest_a1 = ACC1 - ((FB_A1 * rvb->FB_ALPHA) >> 15);
+
+   mix_dest_b0 = FB_A0 + (((ACC0 - FB_A0) * rvb->FB_ALPHA - FB_B0 * rvb->FB_X) >> 15);
+   mix_dest_b1 = FB_A1 + (((ACC1 - FB_A1) * rvb->FB_ALPHA - FB_B1 * rvb->FB_X) >> 15);
+
+   ref_s_buffer(MIX_DEST_A0, mix_dest_a0);
+   ref_s_buffer(MIX_DEST_A1, mix_dest_a1);
+   ref_s_buffer(MIX_DEST_B0, mix_dest_b0);
+   ref_s_buffer(MIX_DEST_B1, mix_dest_b1);
+
+   l = (mix_dest_a0 + mix_dest_b0) / 2;
+   r = (mix_dest_a1 + mix_dest_b1) / 2;
+
+   l = (l * rvb->VolLeft)  >> 15; // 15?
+   r = (r * rvb->VolRight) >> 15;
+
+   SSumLR[ns++] += l;
+   SSumLR[ns++] += r;
+   SSumLR[ns++] += l;
+   SSumLR[ns++] += r;
+
+   curr_addr++;
+   if (curr_addr >= 0x40000) curr_addr = rvb->StartAddr;
+  }
+}
+
+static void RefMixREVERB_off(int *SSumLR, int ns_to, int curr_addr)
+{
+ const REVERBInfo *rvb = spu.rvb;
+ int space = 0x40000 - rvb->StartAddr;
+ int l, r, ns;
+
+ for (ns = 0; ns < ns_to * 2; )
+  {
+   preload(SSumLR + ns + 64*2/4 - 4);
+
+   l = (ref_g_buffer(MIX_DEST_A0) + ref_g_buffer(MIX_DEST_B0)) / 2;
+   r = (ref_g_buffer(MIX_DEST_A1) + ref_g_buffer(MIX_DEST_B1)) / 2;
+
+   l = (l * rvb->VolLeft)  >> 15;
+   r = (r * rvb->VolRight) >> 15;
+
+   SSumLR[ns++] += l;
+   SSumLR[ns++] += r;
+   SSumLR[ns++] += l;
+   SSumLR[ns++] += r;
+
+   curr_addr++;
+   if (curr_addr >= 0x40000) curr_addr = rvb->StartAddr;
+  }
+}
+
+#undef ref_g_buffer
+#undef ref_s_buffer
+#undef ref_s_buffer1
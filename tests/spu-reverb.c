@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Reverb checks for the dfsound SPU plugin
+ *
+ * MixREVERB() and MixREVERB_off() resolve their taps once per wrap-free
+ * run. Compare them with the reference mixers, which wrap every tap of
+ * every sample, over random register sets, work areas down to a few
+ * samples, start addresses and block lengths: the mixed output and the
+ * SPU RAM must be identical.
+ *
+ * Usage: spu-reverb [iterations]
+ */
+
+#include <stdbool.h>
+
+#include <dfsound/spu.c>
+
+#include "spu-reverb-ref.h"
+#include "test.h"
+
+#define SPU_RAM_SIZE	(512 * 1024)
+
+static unsigned int failures;
+static uint32_t seed = 0x6b43a9b5;
+
+static uint32_t rand32(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+
+	return seed;
+}
+
+static void random_reverb(void)
+{
+	REVERBInfo *rvb = spu.rvb;
+	unsigned int i;
+	uint16_t addr;
+
+	/* Mostly small work areas, where the taps wrap all the time */
+	switch (rand32() & 3) {
+	case 0:
+		addr = 0x201 + rand32() % (0xfffe - 0x201);
+		break;
+	case 1:
+		addr = 0xfff0 + rand32() % 0xf;
+		break;
+	default:
+		addr = 0xffc0 + rand32() % 0x3f;
+		break;
+	}
+
+	regAreaGet(H_SPUReverbAddr) = addr;
+
+	/* The tap offsets, REVERBPrep() reduces them to the work area */
+	for (i = 0; i < 32; i++)
+		spu.regArea[(0x1c0 >> 1) + i] = rand32();
+
+	rvb->StartAddr = 0;
+	REVERBPrep();
+
+	rvb->VolLeft = (int16_t)rand32();
+	rvb->VolRight = (int16_t)rand32();
+	rvb->IIR_ALPHA = (int16_t)rand32();
+	rvb->ACC_COEF_A = (int16_t)rand32();
+	rvb->ACC_COEF_B = (int16_t)rand32();
+	rvb->ACC_COEF_C = (int16_t)rand32();
+	rvb->ACC_COEF_D = (int16_t)rand32();
+	rvb->IIR_COEF = (int16_t)rand32();
+	rvb->FB_ALPHA = (int16_t)rand32();
+	rvb->FB_X = (int16_t)rand32();
+	rvb->IN_COEF_L = (int16_t)rand32();
+	rvb->IN_COEF_R = (int16_t)rand32();
+}
+
+static void compare(unsigned short *ram, unsigned short *ref_ram, bool on)
+{
+	/* The mixers work on groups of 4 entries */
+	static int ssum[NSSIZE * 2 + 4], ref_ssum[NSSIZE * 2 + 4];
+	static int rvb_in[NSSIZE * 2 + 4];
+	int i, ns_to, curr_addr, space, start;
+
+	start = spu.rvb->StartAddr;
+	space = 0x40000 - start;
+	curr_addr = start + rand32() % space;
+	ns_to = 1 + rand32() % NSSIZE;
+
+	for (i = 0; i < NSSIZE * 2 + 4; i++) {
+		ssum[i] = ref_ssum[i] = (int16_t)rand32();
+		rvb_in[i] = (int16_t)rand32();
+	}
+
+	/* Nothing is written outside of the work area */
+	for (i = start; i < 0x40000; i++)
+		ram[i] = rand32();
+	memcpy(ref_ram + start, ram + start, space * 2);
+
+	spu.spuMem = ram;
+	if (on)
+		MixREVERB(ssum, rvb_in, ns_to, curr_addr);
+	else
+		MixREVERB_off(ssum, ns_to, curr_addr);
+
+	spu.spuMem = ref_ram;
+	if (on)
+		RefMixREVERB(ref_ssum, rvb_in, ns_to, curr_addr);
+	else
+		RefMixREVERB_off(ref_ssum, ns_to, curr_addr);
+
+	if (memcmp(ssum, ref_ssum, sizeof(ssum))
+	    || memcmp(ram + start, ref_ram + start, space * 2)) {
+		if (failures < 10) {
+			fprintf(stderr, "MixREVERB%s mismatch: start 0x%05x, "
+				"curr 0x%05x, %d samples\n", on ? "" : "_off",
+				spu.rvb->StartAddr, curr_addr, ns_to);
+		}
+
+		failures++;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i, iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 5000;
+	unsigned short *ram, *ref_ram;
+
+	SPUinit();
+
+	ram = calloc(1, SPU_RAM_SIZE);
+	ref_ram = calloc(1, SPU_RAM_SIZE);
+
+	for (i = 0; i < iterations; i++) {
+		random_reverb();
+		compare(ram, ref_ram, i & 1);
+	}
+
+	/* A work area of 8 samples: every tap wraps within each block */
+	regAreaGet(H_SPUReverbAddr) = 0xfffe;
+	spu.rvb->StartAddr = 0;
+	REVERBPrep();
+	check(spu.rvb->StartAddr == 0x40000 - 8);
+	compare(ram, ref_ram, true);
+
+	free(ram);
+	free(ref_ram);
+
+	if (failures)
+		fprintf(stderr, "%u checks failed\n", failures);
+
+	return !!failures;
+}
@@ -0,0 +1,20 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Common helpers for the host tests
+ */
+
+#ifndef __TESTS_TEST_H
+#define __TESTS_TEST_H
+
+#include <stdio.h>
+
+/* Each test defines "static unsigned int failures;" */
+#define check(cond) do {						\
+	if (!(cond)) {							\
+		fprintf(stderr, "%s:%d: check failed: %s\n",		\
+			__FILE__, __LINE__, #cond);			\
+		failures++;						\
+	}								\
+} while (0)
+
+#endif /* __TESTS_TEST_H */